@@ -0,0 +1,423 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "stadium.hpp"
+#include "selector.hpp"
+#include "selection_wheel.hpp"
+#include "dna_utils.hpp"
+#include "dna_loader.hpp"
+#include "genetic_optimizer.hpp"
+#include "cma_es.hpp"
+#include "differential_evolution.hpp"
+#include "population_stats.hpp"
+
+
+/*
+	Headless microbenchmarks of the hot kernels.
+	Each benchmark is calibrated so that one sample lasts at least min_sample_time,
+	then measured over several samples. Results are printed as a table on stderr
+	and as JSON on stdout (or in the file given with --json).
+
+	Usage: AutoRocketBench [--filter substring] [--samples n] [--json file]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Benchmark
+{
+	std::string name;
+	// Runs the measured code the given number of times
+	std::function<void(uint64_t)> run;
+};
+
+struct Result
+{
+	std::string name;
+	uint64_t iterations;
+	uint32_t samples;
+	double mean_ns;
+	double median_ns;
+	double stddev_ns;
+	double min_ns;
+	double max_ns;
+};
+
+// Keeps the selector and stadium logs out of the results
+struct SilentCout
+{
+	std::stringstream sink;
+	std::streambuf* previous;
+
+	SilentCout()
+		: previous(std::cout.rdbuf(sink.rdbuf()))
+	{}
+
+	~SilentCout()
+	{
+		std::cout.rdbuf(previous);
+	}
+};
+
+// Keeps a result alive so that the compiler doesn't remove the code computing it
+template<typename T>
+void escape(const T& value)
+{
+	volatile T sink = value;
+	(void)sink;
+}
+
+double measure(const Benchmark& benchmark, uint64_t iterations)
+{
+	const Clock::time_point start = Clock::now();
+	benchmark.run(iterations);
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+Result runBenchmark(const Benchmark& benchmark, uint32_t samples)
+{
+	const double min_sample_time = 20e6;
+	uint64_t iterations = 1;
+	// Calibration, also used as warmup
+	while (measure(benchmark, iterations) < min_sample_time && iterations < (1ull << 30)) {
+		iterations *= 2;
+	}
+
+	std::vector<double> per_iteration(samples);
+	for (uint32_t i(0); i < samples; ++i) {
+		per_iteration[i] = measure(benchmark, iterations) / double(iterations);
+	}
+	std::sort(per_iteration.begin(), per_iteration.end());
+
+	Result result;
+	result.name = benchmark.name;
+	result.iterations = iterations;
+	result.samples = samples;
+	result.mean_ns = std::accumulate(per_iteration.begin(), per_iteration.end(), 0.0) / samples;
+	result.median_ns = per_iteration[samples / 2];
+	double variance = 0.0;
+	for (const double t : per_iteration) {
+		variance += (t - result.mean_ns) * (t - result.mean_ns);
+	}
+	result.stddev_ns = std::sqrt(variance / samples);
+	result.min_ns = per_iteration.front();
+	result.max_ns = per_iteration.back();
+	return result;
+}
+
+void writeJson(std::ostream& os, const std::vector<Result>& results)
+{
+	os << "{\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"benchmarks\": [\n";
+	for (uint64_t i(0); i < results.size(); ++i) {
+		const Result& r = results[i];
+		os << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations << ", \"samples\": " << r.samples
+		   << ", \"mean_ns\": " << r.mean_ns << ", \"median_ns\": " << r.median_ns << ", \"stddev_ns\": " << r.stddev_ns
+		   << ", \"min_ns\": " << r.min_ns << ", \"max_ns\": " << r.max_ns << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	os << "  ]\n}\n";
+}
+
+std::string getTempFilename(const std::string& name)
+{
+	return "autorocket_bench_" + name + ".bin";
+}
+
+std::vector<Benchmark> createBenchmarks()
+{
+	std::vector<Benchmark> benchmarks;
+	const sf::Vector2f area_size(1600.0f, 900.0f);
+
+	benchmarks.push_back({ "network/layer_process", [](uint64_t n) {
+		static Rocket rocket;
+		static const std::vector<float> inputs(rocket.network.getInputSize(), 0.5f);
+		static std::vector<float> outputs(rocket.network.getLayers().front().getNeuronsCount());
+		for (uint64_t i(n); i--;) {
+			rocket.network.getLayers().front().process(rocket.network.parameters, inputs.data(), outputs.data());
+		}
+	} });
+
+	benchmarks.push_back({ "network/execute", [](uint64_t n) {
+		static Rocket rocket;
+		// Inputs then the layers' values
+		static std::vector<float> state(rocket.network.getStateSize(), 0.5f);
+		for (uint64_t i(n); i--;) {
+			rocket.network.execute(state.data());
+		}
+	} });
+
+	benchmarks.push_back({ "network/execute_batch_4", [](uint64_t n) {
+		static Rocket rocket;
+		static const std::vector<float> inputs(rocket.network.getInputSize() * 4, 0.5f);
+		static std::vector<float> outputs(rocket.network.getOutputSize() * 4);
+		static std::vector<float> scratch;
+		for (uint64_t i(n); i--;) {
+			rocket.network.executeBatch(inputs.data(), 4, outputs.data(), scratch);
+		}
+	} });
+
+	for (const uint32_t population : { 500u, 2000u }) {
+		for (const uint32_t threads : { 1u, 2u, 4u }) {
+			const std::string name = "stadium/update/pop_" + std::to_string(population) + "/threads_" + std::to_string(threads);
+			auto stadium = std::make_shared<std::unique_ptr<Stadium>>();
+			benchmarks.push_back({ name, [=](uint64_t n) {
+				SilentCout silent;
+				std::unique_ptr<Stadium>& s = *stadium;
+				if (!s) {
+					s = std::make_unique<Stadium>(population, area_size, 1, threads);
+					s->initializeIteration();
+				}
+				for (uint64_t i(n); i--;) {
+					if (!s->getAliveCount() || s->current_iteration.time > 90.0f) {
+						s->initializeIteration();
+					}
+					s->update(0.007f, false);
+				}
+			} });
+		}
+	}
+
+	for (const bool rotation_vectors : { false, true }) {
+		const std::string name = std::string("stadium/update/pop_2000/threads_1/") + (rotation_vectors ? "rotation_vectors" : "trigonometry");
+		auto stadium = std::make_shared<std::unique_ptr<Stadium>>();
+		benchmarks.push_back({ name, [=](uint64_t n) {
+			SilentCout silent;
+			std::unique_ptr<Stadium>& s = *stadium;
+			if (!s) {
+				s = std::make_unique<Stadium>(2000, area_size, 1, 1);
+				s->rotation_vectors = rotation_vectors;
+				s->initializeIteration();
+			}
+			for (uint64_t i(n); i--;) {
+				if (!s->getAliveCount() || s->current_iteration.time > 90.0f) {
+					s->initializeIteration();
+				}
+				s->update(0.007f, false);
+			}
+		} });
+	}
+
+	// 64 steps of a population that does not fit in cache
+	for (const bool blocked : { false, true }) {
+		const std::string name = std::string("stadium/64_steps/pop_20000/threads_1/") + (blocked ? "blocked" : "stepwise");
+		auto stadium = std::make_shared<std::unique_ptr<Stadium>>();
+		benchmarks.push_back({ name, [=](uint64_t n) {
+			SilentCout silent;
+			std::unique_ptr<Stadium>& s = *stadium;
+			if (!s) {
+				s = std::make_unique<Stadium>(20000, area_size, 1, 1);
+				s->initializeIteration();
+			}
+			for (uint64_t i(n); i--;) {
+				if (!s->getAliveCount() || s->current_iteration.time > 90.0f) {
+					s->initializeIteration();
+				}
+				if (blocked) {
+					s->updateBlocked(0.007f, 64);
+				}
+				else {
+					for (uint32_t step(0); step < 64; ++step) {
+						s->update(0.007f, false);
+					}
+				}
+			}
+		} });
+	}
+
+	for (const uint32_t threads : { 1u, 4u }) {
+		const std::string name = "population_stats/compute/pop_20000/threads_" + std::to_string(threads);
+		auto stadium = std::make_shared<std::unique_ptr<Stadium>>();
+		auto stats = std::make_shared<PopulationStats>();
+		benchmarks.push_back({ name, [=](uint64_t n) {
+			SilentCout silent;
+			std::unique_ptr<Stadium>& s = *stadium;
+			if (!s) {
+				s = std::make_unique<Stadium>(20000, area_size, 1, threads);
+				s->initializeIteration();
+				s->updateBlocked(0.007f, 64);
+			}
+			for (uint64_t i(n); i--;) {
+				stats->compute(*s, 0);
+			}
+		} });
+	}
+
+	benchmarks.push_back({ "rotation/rotate_4096", [](uint64_t n) {
+		static std::vector<sf::Vector2f> directions(4096, sf::Vector2f(0.0f, 1.0f));
+		for (uint64_t i(n); i--;) {
+			for (sf::Vector2f& direction : directions) {
+				direction = Rotation::rotate(direction, 0.001f);
+			}
+		}
+	} });
+
+	benchmarks.push_back({ "selector/next_generation/pop_2000", [](uint64_t n) {
+		SilentCout silent;
+		static Selector<Rocket> selector(2000);
+		selector.out_file = getTempFilename("selector");
+		for (uint64_t i(n); i--;) {
+			for (Rocket& r : selector.getCurrentPopulation()) {
+				r.fitness = NumberGenerator<>::getInstance().getUnder(100.0f);
+			}
+			selector.nextGeneration();
+		}
+	} });
+
+	// Cost of one generation of each optimizer for the rocket's genome, without evaluation
+	for (const std::string optimizer_name : { "ga", "cmaes", "de" }) {
+		auto optimizer = std::make_shared<std::unique_ptr<Optimizer>>();
+		benchmarks.push_back({ "optimizer/ask_tell/pop_2000/" + optimizer_name, [=](uint64_t n) {
+			static std::vector<DNA> genomes(2000, Rocket().dna);
+			static std::vector<float> fitness(2000);
+			std::unique_ptr<Optimizer>& o = *optimizer;
+			if (!o) {
+				if (optimizer_name == "ga") {
+					o = std::make_unique<GeneticOptimizer>();
+				}
+				else if (optimizer_name == "cmaes") {
+					o = std::make_unique<CmaEs>();
+				}
+				else {
+					o = std::make_unique<DifferentialEvolution>();
+				}
+			}
+			for (uint64_t i(n); i--;) {
+				for (float& f : fitness) {
+					f = NumberGenerator<>::getInstance().getUnder(100.0f);
+				}
+				o->tell(genomes, fitness);
+				o->ask(genomes);
+			}
+		} });
+	}
+
+	benchmarks.push_back({ "selection_wheel/pick/pop_2000", [](uint64_t n) {
+		static std::vector<Rocket> population(2000);
+		static SelectionWheel wheel(500);
+		static bool initialized = false;
+		if (!initialized) {
+			for (Rocket& r : population) {
+				r.fitness = NumberGenerator<>::getInstance().getUnder(100.0f);
+			}
+			wheel.addFitnessScores(population);
+			initialized = true;
+		}
+		uint64_t checksum = 0;
+		for (uint64_t i(n); i--;) {
+			uint64_t index;
+			wheel.pick(population, &index);
+			checksum += index;
+		}
+		escape(checksum);
+	} });
+
+	benchmarks.push_back({ "dna_utils/make_child", [](uint64_t n) {
+		static Rocket parent_1;
+		static Rocket parent_2;
+		for (uint64_t i(n); i--;) {
+			const DNA child = DNAUtils::makeChild<float>(parent_1.dna, parent_2.dna, 0.1f);
+			escape(child.code[0]);
+		}
+	} });
+
+	benchmarks.push_back({ "dna_utils/make_child_in_place", [](uint64_t n) {
+		static Rocket parent_1;
+		static Rocket parent_2;
+		static Rocket child;
+		for (uint64_t i(n); i--;) {
+			DNAUtils::makeChild<float>(parent_1.dna, parent_2.dna, 0.1f, child.dna);
+			child.reloadDNA();
+			escape(child.dna.code[0]);
+		}
+	} });
+
+	benchmarks.push_back({ "dna_loader/write", [](uint64_t n) {
+		static Rocket rocket;
+		const std::string filename = getTempFilename("dna_write");
+		std::remove(filename.c_str());
+		for (uint64_t i(n); i--;) {
+			DnaLoader::writeDnaToFile(filename, rocket.dna);
+		}
+		std::remove(filename.c_str());
+	} });
+
+	benchmarks.push_back({ "dna_loader/read", [](uint64_t n) {
+		SilentCout silent;
+		static Rocket rocket;
+		const std::string filename = getTempFilename("dna_read");
+		const uint64_t bytes_count = rocket.dna.getBytesCount();
+		static bool written = false;
+		if (!written) {
+			std::remove(filename.c_str());
+			for (uint32_t i(0); i < 64; ++i) {
+				DnaLoader::writeDnaToFile(filename, rocket.dna);
+			}
+			written = true;
+		}
+		for (uint64_t i(n); i--;) {
+			const DNA dna = DnaLoader::loadDnaFrom(filename, bytes_count, i % 64);
+			escape(dna.code[0]);
+		}
+	} });
+
+	benchmarks.push_back({ "swarm/execute/threads_4", [](uint64_t n) {
+		static swrm::Swarm swarm(4);
+		for (uint64_t i(n); i--;) {
+			auto group = swarm.execute([](uint32_t, uint32_t) {});
+			group.waitExecutionDone();
+		}
+	} });
+
+	return benchmarks;
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	std::string json_filename;
+	uint32_t samples = 10;
+	for (int i(1); i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		}
+		else if (arg == "--samples" && i + 1 < argc) {
+			samples = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--json" && i + 1 < argc) {
+			json_filename = argv[++i];
+		}
+	}
+
+	// Same random sequence on every run
+	NumberGenerator<>::initialize(false);
+
+	std::vector<Result> results;
+	for (const Benchmark& benchmark : createBenchmarks()) {
+		if (benchmark.name.find(filter) == std::string::npos) {
+			continue;
+		}
+		const Result result = runBenchmark(benchmark, samples);
+		std::cerr << result.name << ": " << result.median_ns << " ns (mean " << result.mean_ns << ", stddev " << result.stddev_ns << ")" << std::endl;
+		results.push_back(result);
+	}
+	std::remove(getTempFilename("selector").c_str());
+	std::remove(getTempFilename("dna_read").c_str());
+
+	if (json_filename.empty()) {
+		writeJson(std::cout, results);
+	}
+	else {
+		std::ofstream outfile(json_filename);
+		writeJson(outfile, results);
+	}
+
+	return 0;
+}
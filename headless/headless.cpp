@@ -0,0 +1,283 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stadium.hpp"
+#include "replay.hpp"
+#include "frame_exporter.hpp"
+#include "genetic_optimizer.hpp"
+#include "cma_es.hpp"
+#include "differential_evolution.hpp"
+#include "evaluation_coordinator.hpp"
+#include "evaluation_worker.hpp"
+#include "steady_state.hpp"
+#include "population_stats.hpp"
+
+
+/*
+	Training without window, for hosts that have no display.
+	The champion's flight can be exported every few generations as a PPM sequence
+	or as raw RGB24 frames piped to a command (an encoder like ffmpeg).
+
+	Usage: AutoRocketHeadless [--generations n] [--population n] [--scenarios n] [--threads n] [--pin-threads 0|1]
+	                          [--video-every n] [--video-prefix path] [--video-pipe command]
+	                          [--video-size WxH] [--fps n]
+	                          [--optimizer selector|ga|cmaes|de] [--target-fitness f]
+	                          [--listen port] [--workers n] [--batch-size n]
+	                          [--mode generational|steady-state]
+	                          [--stats-file path] [--stats-period seconds] [--profile 0|1] [--population-csv path]
+	       AutoRocketHeadless --worker host:port [--threads n] [--pin-threads 0|1]
+
+	Optimizers are compared by the number of rockets evaluated before reaching the target fitness.
+	With --listen, the evaluation is distributed to worker processes started with --worker,
+	--workers is the number of workers to wait for before the first generation.
+	By default there is one thread per physical core, --pin-threads keeps each one on its core
+	and allocates its rockets on its NUMA node.
+	With --stats-file, the run's live metrics are rewritten in this JSON file every period,
+	they include the phase timings with --profile 1 (it slows the simulation down).
+	Each generation is summarized in the log, fully in the --population-csv file (generational mode only).
+	In steady state mode, a generation is only the period between two reports:
+	as many episodes as the population's size.
+*/
+
+std::unique_ptr<Optimizer> createOptimizer(const std::string& name, swrm::Swarm& swarm)
+{
+	if (name == "ga") {
+		return std::make_unique<GeneticOptimizer>();
+	}
+	else if (name == "cmaes") {
+		return std::make_unique<CmaEs>(1.0f, &swarm);
+	}
+	else if (name == "de") {
+		return std::make_unique<DifferentialEvolution>();
+	}
+	return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t generations = 100;
+	uint32_t population = 2000;
+	uint32_t scenarios_count = 4;
+	uint32_t threads = 0;
+	bool pin_threads = false;
+	uint32_t video_every = 0;
+	std::string video_prefix = "../champion";
+	std::string video_pipe;
+	uint32_t video_width = 1280;
+	uint32_t video_height = 720;
+	float fps = 30.0f;
+	std::string optimizer_name = "selector";
+	float target_fitness = 0.0f;
+	uint32_t listen_port = 0;
+	uint32_t workers_count = 0;
+	uint32_t batch_size = 64;
+	std::string coordinator_address;
+	std::string mode = "generational";
+	std::string stats_file;
+	float stats_period = 1.0f;
+	bool profile = false;
+	std::string population_csv;
+	for (int i(1); i + 1 < argc; i += 2) {
+		const std::string arg = argv[i];
+		const std::string value = argv[i + 1];
+		if (arg == "--generations") {
+			generations = std::stoul(value);
+		}
+		else if (arg == "--population") {
+			population = std::stoul(value);
+		}
+		else if (arg == "--scenarios") {
+			scenarios_count = std::stoul(value);
+		}
+		else if (arg == "--threads") {
+			threads = std::stoul(value);
+		}
+		else if (arg == "--pin-threads") {
+			pin_threads = value != "0";
+		}
+		else if (arg == "--video-every") {
+			video_every = std::stoul(value);
+		}
+		else if (arg == "--video-prefix") {
+			video_prefix = value;
+		}
+		else if (arg == "--video-pipe") {
+			video_pipe = value;
+		}
+		else if (arg == "--video-size") {
+			std::sscanf(value.c_str(), "%ux%u", &video_width, &video_height);
+		}
+		else if (arg == "--fps") {
+			fps = std::stof(value);
+		}
+		else if (arg == "--optimizer") {
+			optimizer_name = value;
+		}
+		else if (arg == "--target-fitness") {
+			target_fitness = std::stof(value);
+		}
+		else if (arg == "--listen") {
+			listen_port = std::stoul(value);
+		}
+		else if (arg == "--workers") {
+			workers_count = std::stoul(value);
+		}
+		else if (arg == "--batch-size") {
+			batch_size = std::stoul(value);
+		}
+		else if (arg == "--worker") {
+			coordinator_address = value;
+		}
+		else if (arg == "--mode") {
+			mode = value;
+		}
+		else if (arg == "--stats-file") {
+			stats_file = value;
+		}
+		else if (arg == "--stats-period") {
+			stats_period = std::stof(value);
+		}
+		else if (arg == "--profile") {
+			profile = value != "0";
+		}
+		else if (arg == "--population-csv") {
+			population_csv = value;
+		}
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	NumberGenerator<>::initialize();
+
+	if (!coordinator_address.empty()) {
+		const std::size_t separator = coordinator_address.rfind(':');
+		if (separator == std::string::npos) {
+			std::cerr << "Expected host:port, got " << coordinator_address << std::endl;
+			return 1;
+		}
+		const sf::IpAddress host(coordinator_address.substr(0, separator));
+		const unsigned short port = static_cast<unsigned short>(std::stoul(coordinator_address.substr(separator + 1)));
+		EvaluationWorker worker(threads, pin_threads);
+		return worker.run(host, port) ? 0 : 1;
+	}
+
+	const float dt = 0.007f;
+	Stadium stadium(population, sf::Vector2f(1600.0f, 900.0f), scenarios_count, threads, pin_threads);
+	std::cout << "Threads: " << stadium.thread_count << " (" << stadium.swarm.getPinnedCount() << " pinned) on "
+		<< stadium.topology.getCoresCount() << " cores, " << stadium.topology.getNodesCount() << " NUMA nodes" << std::endl;
+	stadium.scenarios_renewal = 5;
+	stadium.use_fitness_cache = true;
+	stadium.rotation_vectors = true;
+	std::cout << "Memory per genome: " << stadium.getBytesPerGenome() << " bytes" << std::endl;
+	stadium.optimizer = createOptimizer(optimizer_name, stadium.swarm);
+	if (!stadium.optimizer && optimizer_name != "selector") {
+		std::cerr << "Unknown optimizer " << optimizer_name << std::endl;
+		return 1;
+	}
+
+	// Exports run between generations, when the swarm is idle
+	FrameExporter exporter(video_width, video_height, &stadium.swarm);
+	if (video_every && !video_pipe.empty() && !exporter.openPipe(video_pipe)) {
+		std::cerr << "Cannot open pipe " << video_pipe << std::endl;
+		return 1;
+	}
+
+	EvaluationCoordinator coordinator;
+	coordinator.batch_size = batch_size;
+	if (listen_port) {
+		if (!coordinator.listen(static_cast<unsigned short>(listen_port))) {
+			std::cerr << "Cannot listen on port " << listen_port << std::endl;
+			return 1;
+		}
+		std::cout << "Waiting for " << workers_count << " workers on port " << listen_port << std::endl;
+		if (!coordinator.waitForWorkers(workers_count, 60.0f)) {
+			std::cout << "Starting with " << coordinator.getWorkersCount() << " workers" << std::endl;
+		}
+	}
+
+	// Phase timings come from the profiler
+	Profiler& profiler = Profiler::getInstance();
+	profiler.enabled = profile;
+	if (!stats_file.empty()) {
+		stadium.startLiveStats(stats_file, stats_period);
+	}
+
+	std::unique_ptr<SteadyStateEvolution> steady_state;
+	if (mode == "steady-state") {
+		steady_state = std::make_unique<SteadyStateEvolution>(stadium);
+	}
+	else if (mode != "generational") {
+		std::cerr << "Unknown mode " << mode << std::endl;
+		return 1;
+	}
+
+	PopulationStats population_stats;
+	if (!population_csv.empty()) {
+		population_stats.setCsvOutput(population_csv);
+	}
+
+	Replay replay;
+	std::vector<float> fitness_history;
+	// Cached results are not counted
+	uint64_t evaluations_count = 0;
+	DNA champion(0);
+	for (uint32_t generation(0); generation < generations; ++generation) {
+		if (steady_state) {
+			steady_state->run(dt, 90.0f, population);
+			fitness_history.push_back(steady_state->best.fitness);
+			evaluations_count = steady_state->evaluations_count * stadium.scenarios_count;
+			champion = steady_state->best.dna;
+		}
+		else {
+			stadium.initializeIteration();
+			if (listen_port) {
+				coordinator.evaluate(stadium, dt, 90.0f);
+			}
+			else {
+				// Nothing to display, each tile of genomes runs its whole episode at once
+				stadium.updateBlocked(dt, stadium.getRemainingSteps(dt, 90.0f));
+			}
+
+			// Workers update the iteration's best concurrently, the maximum is taken again once they are done
+			population_stats.compute(stadium, generation);
+			fitness_history.push_back(population_stats.last.fitness_max);
+			evaluations_count += uint64_t(population) * stadium.scenarios_count - stadium.current_iteration.cached_count;
+			stadium.nextIteration();
+			champion = stadium.selector.getBest().dna;
+		}
+		const uint32_t champion_seed = stadium.scenarios[0].seed;
+		if (stadium.live_stats) {
+			const float mean_fitness = steady_state ? steady_state->getAverageFitness() : population_stats.last.fitness_mean;
+			stadium.live_stats->publishGeneration(generation, fitness_history.back(), mean_fitness, evaluations_count);
+			if (profiler.enabled) {
+				const uint32_t steps = steady_state ? steady_state->run_steps : stadium.current_iteration.step;
+				stadium.live_stats->publishTimings(profiler.endGeneration(generation, steps));
+			}
+		}
+		std::cout << "Generation " << generation << " best " << fitness_history.back() << " evaluations " << evaluations_count;
+		if (!steady_state) {
+			const PopulationStats::Summary& summary = population_stats.last;
+			std::cout << " mean " << summary.fitness_mean << " median " << summary.fitness_median << " p90 " << summary.fitness_p90
+				<< " survival " << summary.survival_median << "s targets " << summary.targets_mean << " diversity " << summary.diversity;
+		}
+		std::cout << std::endl;
+
+		if (video_every && (generation + 1) % video_every == 0) {
+			if (video_pipe.empty()) {
+				exporter.openSequence(video_prefix + "_" + std::to_string(generation));
+			}
+			replay.load(stadium, champion, champion_seed, dt);
+			exporter.exportReplay(replay, fps, fitness_history, stadium.targets_count);
+		}
+
+		if (target_fitness > 0.0f && fitness_history.back() >= target_fitness) {
+			std::cout << "Target fitness reached by " << optimizer_name << " after " << evaluations_count << " evaluations" << std::endl;
+			break;
+		}
+	}
+
+	return 0;
+}
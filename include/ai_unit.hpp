@@ -18,28 +18,47 @@ struct AiUnit : public Unit
 		updateNetwork();
 	}
 
-	void execute(const std::vector<float>& inputs)
+	// The network reads its parameters in the DNA, a copy has to point to its own
+	AiUnit(const AiUnit& other)
+		: Unit(other)
+		, network(other.network)
 	{
-		const std::vector<float>& outputs = network.execute(inputs);
-		process(outputs);
+		updateNetwork();
 	}
 
-	void updateNetwork()
+	AiUnit(AiUnit&& other) noexcept
+		: Unit(std::move(other))
+		, network(std::move(other.network))
 	{
-		uint64_t index = 0;
-		for (Layer& layer : network.layers) {
-			const uint64_t neurons_count = layer.getNeuronsCount();
-			for (uint64_t i(0); i < neurons_count; ++i) {
-				layer.bias[i] = dna.get<float>(index++);
-			}
+		updateNetwork();
+	}
 
-			for (uint64_t i(0); i < neurons_count; ++i) {
-				const uint64_t weights_count = layer.getWeightsCount();
-				for (uint64_t j(0); j < weights_count; ++j) {
-					layer.weights[i][j] = dna.get<float>(index++);
-				}
-			}
-		}
+	AiUnit& operator=(const AiUnit& other)
+	{
+		Unit::operator=(other);
+		network = other.network;
+		updateNetwork();
+		return *this;
+	}
+
+	AiUnit& operator=(AiUnit&& other) noexcept
+	{
+		Unit::operator=(std::move(other));
+		network = std::move(other.network);
+		updateNetwork();
+		return *this;
+	}
+
+	// The state starts with the inputs, see Network::execute
+	void execute(std::vector<float>& state)
+	{
+		process(network.execute(state.data()));
+	}
+
+	// Weights are stored in the DNA in the network's order
+	void updateNetwork()
+	{
+		network.bind(dna.getFloats());
 	}
 
 	void onUpdateDNA() override
@@ -47,7 +66,7 @@ struct AiUnit : public Unit
 		updateNetwork();
 	}
 
-	virtual void process(const std::vector<float>& outputs) = 0;
+	virtual void process(const float* outputs) = 0;
 
 	Network network;
 };
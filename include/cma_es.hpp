@@ -0,0 +1,316 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <random>
+#include <swarm.hpp>
+#include "optimizer.hpp"
+#include "number_generator.hpp"
+
+
+/*
+	Covariance matrix adaptation evolution strategy, genomes are sampled from N(mean, sigma^2 C).
+	The population's size is the one of the genomes given to tell.
+	Covariance updates and sampling are done by rows, split between the swarm's workers if any.
+*/
+struct CmaEs : Optimizer
+{
+	uint64_t n;
+	uint32_t lambda;
+	uint32_t mu;
+	std::vector<float> weights;
+	float mu_eff;
+	float cc, cs, c1, c_mu, damps, chi_n;
+
+	std::vector<float> mean;
+	float sigma;
+	std::vector<float> pc;
+	std::vector<float> ps;
+	// Row major n x n, C = B diag(D^2) B^T
+	std::vector<float> C;
+	std::vector<float> B;
+	std::vector<float> D;
+	uint32_t generation;
+	uint32_t eigen_generation;
+
+	// Buffers, steps of the mu best genomes and samples
+	std::vector<uint32_t> order;
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> y_w;
+	std::vector<float> tmp;
+	std::normal_distribution<float> normal;
+	swrm::Swarm* swarm;
+
+	CmaEs(float initial_sigma = 1.0f, swrm::Swarm* swarm_ = nullptr)
+		: n(0)
+		, lambda(0)
+		, sigma(initial_sigma)
+		, generation(0)
+		, eigen_generation(0)
+		, swarm(swarm_)
+	{}
+
+	const char* getName() const override
+	{
+		return "cmaes";
+	}
+
+	void initialize(uint64_t parameters_count, uint32_t population_size)
+	{
+		n = parameters_count;
+		lambda = population_size;
+		mu = std::max(1u, lambda / 2);
+		weights.resize(mu);
+		float sum = 0.0f;
+		for (uint32_t i(0); i < mu; ++i) {
+			weights[i] = std::log(mu + 0.5f) - std::log(i + 1.0f);
+			sum += weights[i];
+		}
+		float sum_sq = 0.0f;
+		for (float& w : weights) {
+			w /= sum;
+			sum_sq += w * w;
+		}
+		mu_eff = 1.0f / sum_sq;
+
+		const float nf = float(n);
+		cc = (4.0f + mu_eff / nf) / (nf + 4.0f + 2.0f * mu_eff / nf);
+		cs = (mu_eff + 2.0f) / (nf + mu_eff + 5.0f);
+		c1 = 2.0f / ((nf + 1.3f) * (nf + 1.3f) + mu_eff);
+		c_mu = std::min(1.0f - c1, 2.0f * (mu_eff - 2.0f + 1.0f / mu_eff) / ((nf + 2.0f) * (nf + 2.0f) + mu_eff));
+		damps = 1.0f + 2.0f * std::max(0.0f, std::sqrt((mu_eff - 1.0f) / (nf + 1.0f)) - 1.0f) + cs;
+		chi_n = std::sqrt(nf) * (1.0f - 1.0f / (4.0f * nf) + 1.0f / (21.0f * nf * nf));
+
+		mean.assign(n, 0.0f);
+		pc.assign(n, 0.0f);
+		ps.assign(n, 0.0f);
+		C.assign(n * n, 0.0f);
+		B.assign(n * n, 0.0f);
+		D.assign(n, 1.0f);
+		for (uint64_t i(0); i < n; ++i) {
+			C[i * n + i] = 1.0f;
+			B[i * n + i] = 1.0f;
+		}
+		x.resize(lambda * n);
+		y.resize(mu * n);
+		z.resize(lambda * n);
+		y_w.resize(n);
+		tmp.resize(n);
+		generation = 0;
+		eigen_generation = 0;
+	}
+
+	void tell(const std::vector<DNA>& genomes, const std::vector<float>& fitness) override
+	{
+		const bool first = !n || genomes.size() != lambda;
+		if (first) {
+			initialize(getParametersCount(genomes[0]), as<uint32_t>(genomes.size()));
+		}
+
+		sortIndexes(fitness, order);
+		for (uint32_t i(0); i < lambda; ++i) {
+			read(genomes[i], &x[i * n]);
+		}
+
+		// The search starts around the best genome of the initial population
+		if (first) {
+			std::copy(&x[order[0] * n], &x[order[0] * n] + n, mean.begin());
+			return;
+		}
+
+		// Steps of the best genomes, y = (x - mean) / sigma
+		std::fill(y_w.begin(), y_w.end(), 0.0f);
+		const float inv_sigma = 1.0f / sigma;
+		for (uint32_t i(0); i < mu; ++i) {
+			const float* xi = &x[order[i] * n];
+			float* yi = &y[i * n];
+			for (uint64_t j(0); j < n; ++j) {
+				yi[j] = (xi[j] - mean[j]) * inv_sigma;
+				y_w[j] += weights[i] * yi[j];
+			}
+		}
+		for (uint64_t j(0); j < n; ++j) {
+			mean[j] += sigma * y_w[j];
+		}
+
+		// Evolution paths, C^-1/2 y_w = B D^-1 B^T y_w
+		for (uint64_t i(0); i < n; ++i) {
+			float sum = 0.0f;
+			for (uint64_t j(0); j < n; ++j) {
+				sum += B[j * n + i] * y_w[j];
+			}
+			tmp[i] = sum / D[i];
+		}
+		const float ps_coef = std::sqrt(cs * (2.0f - cs) * mu_eff);
+		float ps_norm_sq = 0.0f;
+		for (uint64_t i(0); i < n; ++i) {
+			float sum = 0.0f;
+			const float* row = &B[i * n];
+			for (uint64_t j(0); j < n; ++j) {
+				sum += row[j] * tmp[j];
+			}
+			ps[i] = (1.0f - cs) * ps[i] + ps_coef * sum;
+			ps_norm_sq += ps[i] * ps[i];
+		}
+		const float ps_norm = std::sqrt(ps_norm_sq);
+		++generation;
+		const float hsig_threshold = (1.4f + 2.0f / (n + 1.0f)) * chi_n;
+		const bool hsig = ps_norm / std::sqrt(1.0f - std::pow(1.0f - cs, 2.0f * generation)) < hsig_threshold;
+		const float pc_coef = hsig ? std::sqrt(cc * (2.0f - cc) * mu_eff) : 0.0f;
+		for (uint64_t i(0); i < n; ++i) {
+			pc[i] = (1.0f - cc) * pc[i] + pc_coef * y_w[i];
+		}
+
+		// Rank one and rank mu updates
+		const float old_coef = 1.0f - c1 - c_mu + (hsig ? 0.0f : c1 * cc * (2.0f - cc));
+		forEachRow([&](uint64_t begin, uint64_t end) {
+			updateCovariance(begin, end, old_coef);
+		});
+
+		sigma *= std::exp((cs / damps) * (ps_norm / chi_n - 1.0f));
+
+		// The decomposition is O(n^3), it is only updated when C has changed enough
+		if ((generation - eigen_generation) * (c1 + c_mu) * n * 10.0f > float(lambda)) {
+			eigen_generation = generation;
+			decompose();
+		}
+	}
+
+	void ask(std::vector<DNA>& genomes) override
+	{
+		// Random numbers are drawn in order so that runs can be reproduced
+		std::mt19937& generator = NumberGenerator<>::getInstance().gen;
+		for (float& v : z) {
+			v = normal(generator);
+		}
+		// x = mean + sigma B (D z)
+		forEachRow([&](uint64_t begin, uint64_t end) {
+			sample(begin, end);
+		}, lambda);
+		for (uint32_t k(0); k < lambda; ++k) {
+			write(&x[k * n], genomes[k]);
+		}
+	}
+
+	// Splits [0, count) between the swarm's workers
+	template<typename Callback>
+	void forEachRow(Callback&& callback, uint64_t count = 0)
+	{
+		const uint64_t rows_count = count ? count : n;
+		if (!swarm) {
+			callback(0, rows_count);
+			return;
+		}
+		auto group = swarm->execute([&](uint32_t thread_id, uint32_t max_thread) {
+			const uint64_t width = rows_count / max_thread;
+			const uint64_t end = (thread_id + 1 == max_thread) ? rows_count : (thread_id + 1) * width;
+			callback(thread_id * width, end);
+		});
+		group.waitExecutionDone();
+	}
+
+	void updateCovariance(uint64_t begin, uint64_t end, float old_coef)
+	{
+		for (uint64_t r(begin); r < end; ++r) {
+			float* __restrict row = &C[r * n];
+			const float pc_r = c1 * pc[r];
+			for (uint64_t c(0); c < n; ++c) {
+				row[c] = old_coef * row[c] + pc_r * pc[c];
+			}
+			for (uint32_t i(0); i < mu; ++i) {
+				const float* __restrict yi = &y[i * n];
+				const float coef = c_mu * weights[i] * yi[r];
+				for (uint64_t c(0); c < n; ++c) {
+					row[c] += coef * yi[c];
+				}
+			}
+		}
+	}
+
+	void sample(uint64_t begin, uint64_t end)
+	{
+		std::vector<float> dz(n);
+		for (uint64_t k(begin); k < end; ++k) {
+			const float* zk = &z[k * n];
+			for (uint64_t j(0); j < n; ++j) {
+				dz[j] = D[j] * zk[j];
+			}
+			float* xk = &x[k * n];
+			for (uint64_t i(0); i < n; ++i) {
+				const float* __restrict row = &B[i * n];
+				float sum = 0.0f;
+				for (uint64_t j(0); j < n; ++j) {
+					sum += row[j] * dz[j];
+				}
+				xk[i] = mean[i] + sigma * sum;
+			}
+		}
+	}
+
+	// Cyclic Jacobi eigen decomposition of C, in double precision
+	void decompose()
+	{
+		std::vector<double> a(C.begin(), C.end());
+		std::vector<double> v(n * n, 0.0);
+		for (uint64_t i(0); i < n; ++i) {
+			v[i * n + i] = 1.0;
+			// Keeps C symmetric despite float rounding
+			for (uint64_t j(i + 1); j < n; ++j) {
+				const double m = 0.5 * (a[i * n + j] + a[j * n + i]);
+				a[i * n + j] = m;
+				a[j * n + i] = m;
+			}
+		}
+
+		for (uint32_t sweep(0); sweep < 50; ++sweep) {
+			double off = 0.0;
+			double diag = 0.0;
+			for (uint64_t i(0); i < n; ++i) {
+				diag += a[i * n + i] * a[i * n + i];
+				for (uint64_t j(i + 1); j < n; ++j) {
+					off += a[i * n + j] * a[i * n + j];
+				}
+			}
+			if (off <= 1e-24 * diag) {
+				break;
+			}
+
+			for (uint64_t p(0); p < n; ++p) {
+				for (uint64_t q(p + 1); q < n; ++q) {
+					const double apq = a[p * n + q];
+					if (std::abs(apq) < 1e-300) {
+						continue;
+					}
+					const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+					const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+					const double c = 1.0 / std::sqrt(t * t + 1.0);
+					const double s = t * c;
+					for (uint64_t k(0); k < n; ++k) {
+						const double akp = a[k * n + p];
+						const double akq = a[k * n + q];
+						a[k * n + p] = c * akp - s * akq;
+						a[k * n + q] = s * akp + c * akq;
+					}
+					for (uint64_t k(0); k < n; ++k) {
+						const double apk = a[p * n + k];
+						const double aqk = a[q * n + k];
+						a[p * n + k] = c * apk - s * aqk;
+						a[q * n + k] = s * apk + c * aqk;
+					}
+					for (uint64_t k(0); k < n; ++k) {
+						const double vkp = v[k * n + p];
+						const double vkq = v[k * n + q];
+						v[k * n + p] = c * vkp - s * vkq;
+						v[k * n + q] = s * vkp + c * vkq;
+					}
+				}
+			}
+		}
+
+		for (uint64_t i(0); i < n; ++i) {
+			D[i] = float(std::sqrt(std::max(1e-20, a[i * n + i])));
+		}
+		std::copy(v.begin(), v.end(), B.begin());
+	}
+};
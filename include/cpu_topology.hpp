@@ -0,0 +1,165 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <tuple>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+/*
+	Physical cores the process is allowed to run on, read from sysfs on Linux.
+	Elsewhere every hardware thread is seen as its own core and nothing can be pinned.
+*/
+struct CpuTopology
+{
+	struct Core
+	{
+		uint32_t node;
+		uint32_t package;
+		uint32_t id;
+		// Logical CPUs of the core, its hyperthreads
+		std::vector<uint32_t> cpus;
+	};
+
+	std::vector<Core> cores;
+
+	CpuTopology()
+	{
+		detect();
+	}
+
+	uint32_t getCoresCount() const
+	{
+		return static_cast<uint32_t>(cores.size());
+	}
+
+	uint32_t getLogicalCount() const
+	{
+		uint32_t result = 0;
+		for (const Core& core : cores) {
+			result += static_cast<uint32_t>(core.cpus.size());
+		}
+		return result;
+	}
+
+	uint32_t getNodesCount() const
+	{
+		uint32_t result = 0;
+		for (const Core& core : cores) {
+			result = std::max(result, core.node + 1);
+		}
+		return result;
+	}
+
+	// One thread per physical core, hyperthreads share the core's FPU and caches
+	uint32_t getDefaultThreadCount() const
+	{
+		return std::max(1u, getCoresCount());
+	}
+
+	// CPU for each worker: the first hyperthread of every core, grouped by node, then the second ones...
+	// Empty when pinning is not supported
+	std::vector<int32_t> getPinningOrder() const
+	{
+		std::vector<int32_t> result;
+#ifdef __linux__
+		for (uint64_t sibling(0); result.size() < getLogicalCount(); ++sibling) {
+			for (const Core& core : cores) {
+				if (sibling < core.cpus.size()) {
+					result.push_back(static_cast<int32_t>(core.cpus[sibling]));
+				}
+			}
+		}
+#endif
+		return result;
+	}
+
+	void detect()
+	{
+		cores.clear();
+#ifdef __linux__
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+			const std::vector<uint32_t> nodes = readNodes();
+			for (uint32_t cpu(0); cpu < CPU_SETSIZE; ++cpu) {
+				if (!CPU_ISSET(cpu, &allowed)) {
+					continue;
+				}
+				const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+				const uint32_t package = readValue(path + "physical_package_id", 0);
+				const uint32_t id = readValue(path + "core_id", cpu);
+				const uint32_t node = cpu < nodes.size() ? nodes[cpu] : 0;
+				addCpu(node, package, id, cpu);
+			}
+		}
+#endif
+		if (cores.empty()) {
+			const uint32_t count = std::max(1u, std::thread::hardware_concurrency());
+			for (uint32_t cpu(0); cpu < count; ++cpu) {
+				addCpu(0, 0, cpu, cpu);
+			}
+		}
+		std::sort(cores.begin(), cores.end(), [](const Core& a, const Core& b) {
+			return std::tie(a.node, a.package, a.id) < std::tie(b.node, b.package, b.id);
+		});
+	}
+
+	void addCpu(uint32_t node, uint32_t package, uint32_t id, uint32_t cpu)
+	{
+		for (Core& core : cores) {
+			if (core.package == package && core.id == id) {
+				core.cpus.push_back(cpu);
+				return;
+			}
+		}
+		cores.push_back({ node, package, id, { cpu } });
+	}
+
+	static uint32_t readValue(const std::string& path, uint32_t default_value)
+	{
+		std::ifstream file(path);
+		uint32_t value = default_value;
+		if (!(file >> value)) {
+			return default_value;
+		}
+		return value;
+	}
+
+	// Node of each CPU, from the nodes' cpulist like "0-15,32-47"
+	static std::vector<uint32_t> readNodes()
+	{
+		std::vector<uint32_t> result;
+		// Node ids can have holes
+		for (uint32_t node(0); node < 256; ++node) {
+			std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+			std::string list;
+			if (!(file >> list)) {
+				continue;
+			}
+			std::size_t position = 0;
+			while (position < list.size()) {
+				std::size_t next = list.find(',', position);
+				if (next == std::string::npos) {
+					next = list.size();
+				}
+				const std::string range = list.substr(position, next - position);
+				const std::size_t dash = range.find('-');
+				const uint32_t first = std::stoul(range.substr(0, dash));
+				const uint32_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+				if (result.size() <= last) {
+					result.resize(last + 1, 0);
+				}
+				for (uint32_t cpu(first); cpu <= last; ++cpu) {
+					result[cpu] = node;
+				}
+				position = next + 1;
+			}
+		}
+		return result;
+	}
+};
@@ -0,0 +1,189 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <SFML/Graphics.hpp>
+#include <swarm.hpp>
+#include "rocket.hpp"
+
+
+/*
+	Downsampled view of the whole population: alive rockets are binned in a grid,
+	each worker fills its own partial grids that are then summed.
+*/
+struct DensityGrid
+{
+	enum Mode
+	{
+		Density,
+		Speed,
+		Fitness,
+		ModesCount
+	};
+
+	struct Partial
+	{
+		std::vector<float> counts;
+		std::vector<float> sums;
+	};
+
+	uint32_t width;
+	uint32_t height;
+	sf::Vector2f area_size;
+	std::vector<Partial> partials;
+
+	DensityGrid(uint32_t width_, uint32_t height_, sf::Vector2f area_size_)
+		: width(width_)
+		, height(height_)
+		, area_size(area_size_)
+	{}
+
+	static const char* getModeName(Mode mode)
+	{
+		static const char* names[ModesCount] = { "density", "speed", "fitness" };
+		return names[mode];
+	}
+
+	// Writes rockets count per cell for Density, the mean speed or fitness of the cell otherwise
+	void accumulate(const std::vector<Rocket>& rockets, Mode mode, std::vector<float>& result, swrm::Swarm* swarm = nullptr)
+	{
+		const uint32_t cells_count = width * height;
+		const uint32_t partials_count = swarm ? swarm->getThreadCount() : 1;
+		partials.resize(partials_count);
+		for (Partial& partial : partials) {
+			partial.counts.resize(cells_count);
+			partial.sums.resize(cells_count);
+		}
+		result.resize(cells_count);
+
+		if (swarm) {
+			const uint64_t rockets_count = rockets.size();
+			auto group_fill = swarm->execute([&](uint32_t thread_id, uint32_t max_thread) {
+				const uint64_t thread_width = rockets_count / max_thread;
+				const uint64_t end = (thread_id + 1 == max_thread) ? rockets_count : (thread_id + 1) * thread_width;
+				fill(rockets, thread_id * thread_width, end, mode, partials[thread_id]);
+			});
+			group_fill.waitExecutionDone();
+
+			auto group_reduce = swarm->execute([&](uint32_t thread_id, uint32_t max_thread) {
+				const uint32_t thread_width = cells_count / max_thread;
+				const uint32_t end = (thread_id + 1 == max_thread) ? cells_count : (thread_id + 1) * thread_width;
+				reduce(thread_id * thread_width, end, mode, result);
+			});
+			group_reduce.waitExecutionDone();
+		}
+		else {
+			fill(rockets, 0, rockets.size(), mode, partials[0]);
+			reduce(0, cells_count, mode, result);
+		}
+	}
+
+	void fill(const std::vector<Rocket>& rockets, uint64_t begin, uint64_t end, Mode mode, Partial& partial) const
+	{
+		std::fill(partial.counts.begin(), partial.counts.end(), 0.0f);
+		std::fill(partial.sums.begin(), partial.sums.end(), 0.0f);
+		const float cell_x = width / area_size.x;
+		const float cell_y = height / area_size.y;
+		for (uint64_t i(begin); i < end; ++i) {
+			const Rocket& r = rockets[i];
+			if (!r.alive) {
+				continue;
+			}
+			const int32_t x = int32_t(r.position.x * cell_x);
+			const int32_t y = int32_t(r.position.y * cell_y);
+			if (x < 0 || y < 0 || x >= int32_t(width) || y >= int32_t(height)) {
+				continue;
+			}
+			const uint32_t cell = y * width + x;
+			partial.counts[cell] += 1.0f;
+			if (mode == Speed) {
+				partial.sums[cell] += getLength(r.velocity);
+			}
+			else if (mode == Fitness) {
+				partial.sums[cell] += r.fitness;
+			}
+		}
+	}
+
+	void reduce(uint32_t begin, uint32_t end, Mode mode, std::vector<float>& result) const
+	{
+		for (uint32_t cell(begin); cell < end; ++cell) {
+			float count = 0.0f;
+			float sum = 0.0f;
+			for (const Partial& partial : partials) {
+				count += partial.counts[cell];
+				sum += partial.sums[cell];
+			}
+			result[cell] = (mode == Density) ? count : (count > 0.0f ? sum / count : 0.0f);
+		}
+	}
+};
+
+
+// Draws a grid of values as one textured quad with a color map
+struct HeatmapRenderer
+{
+	sf::Texture texture;
+	std::vector<uint8_t> pixels;
+	sf::VertexArray quad;
+	uint32_t width;
+	uint32_t height;
+
+	HeatmapRenderer()
+		: quad(sf::Quads, 4)
+		, width(0)
+		, height(0)
+	{}
+
+	void render(const std::vector<float>& values, uint32_t grid_width, uint32_t grid_height, sf::Vector2f area_size, sf::RenderTarget& target, sf::RenderStates states)
+	{
+		if (grid_width != width || grid_height != height) {
+			width = grid_width;
+			height = grid_height;
+			texture.create(width, height);
+			texture.setSmooth(true);
+			pixels.resize(4 * width * height);
+			quad[0] = sf::Vertex(sf::Vector2f(0.0f, 0.0f), sf::Vector2f(0.0f, 0.0f));
+			quad[1] = sf::Vertex(sf::Vector2f(area_size.x, 0.0f), sf::Vector2f(float(width), 0.0f));
+			quad[2] = sf::Vertex(area_size, sf::Vector2f(float(width), float(height)));
+			quad[3] = sf::Vertex(sf::Vector2f(0.0f, area_size.y), sf::Vector2f(0.0f, float(height)));
+		}
+
+		// Log scale so that a few crowded cells don't hide the others
+		const float max_value = values.empty() ? 0.0f : *std::max_element(values.begin(), values.end());
+		const float scale = max_value > 0.0f ? 1.0f / std::log(1.0f + max_value) : 0.0f;
+		for (uint64_t i(0); i < values.size(); ++i) {
+			const sf::Color color = getColor(std::log(1.0f + values[i]) * scale);
+			pixels[4 * i + 0] = color.r;
+			pixels[4 * i + 1] = color.g;
+			pixels[4 * i + 2] = color.b;
+			pixels[4 * i + 3] = color.a;
+		}
+		texture.update(pixels.data());
+
+		states.texture = &texture;
+		target.draw(quad, states);
+	}
+
+	// Transparent black to purple, orange then yellow
+	static sf::Color getColor(float ratio)
+	{
+		const uint32_t stops_count = 4;
+		static const sf::Color stops[stops_count] = {
+			sf::Color(0, 0, 0, 0),
+			sf::Color(120, 30, 140, 200),
+			sf::Color(240, 100, 30, 230),
+			sf::Color(255, 240, 120, 255)
+		};
+		const float position = clamp(0.0f, 1.0f, ratio) * (stops_count - 1);
+		const uint32_t index = std::min(stops_count - 2, uint32_t(position));
+		const float t = position - index;
+		const sf::Color& c1 = stops[index];
+		const sf::Color& c2 = stops[index + 1];
+		return sf::Color(
+			static_cast<uint8_t>(c1.r + t * (c2.r - c1.r)),
+			static_cast<uint8_t>(c1.g + t * (c2.g - c1.g)),
+			static_cast<uint8_t>(c1.b + t * (c2.b - c1.b)),
+			static_cast<uint8_t>(c1.a + t * (c2.a - c1.a))
+		);
+	}
+};
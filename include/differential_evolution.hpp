@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include "optimizer.hpp"
+#include "number_generator.hpp"
+#include "utils.hpp"
+
+
+/*
+	DE/rand/1/bin: each member of the population is challenged by a trial genome,
+	made of its own parameters crossed with the difference of two others added to a third one.
+	The trial replaces the member if it does at least as well.
+*/
+struct DifferentialEvolution : Optimizer
+{
+	uint64_t n;
+	uint32_t population_size;
+	float differential_weight;
+	float crossover_probability;
+	// Row major, one genome per row
+	std::vector<float> members;
+	std::vector<float> members_fitness;
+	std::vector<float> trials;
+
+	DifferentialEvolution(float differential_weight_ = 0.5f, float crossover_probability_ = 0.9f)
+		: n(0)
+		, population_size(0)
+		, differential_weight(differential_weight_)
+		, crossover_probability(crossover_probability_)
+	{}
+
+	const char* getName() const override
+	{
+		return "de";
+	}
+
+	void tell(const std::vector<DNA>& genomes, const std::vector<float>& fitness) override
+	{
+		// The first genomes are the initial population
+		if (!n || genomes.size() != population_size) {
+			n = getParametersCount(genomes[0]);
+			population_size = as<uint32_t>(genomes.size());
+			members.resize(population_size * n);
+			trials.resize(population_size * n);
+			for (uint32_t i(0); i < population_size; ++i) {
+				read(genomes[i], &members[i * n]);
+			}
+			members_fitness = fitness;
+			return;
+		}
+
+		for (uint32_t i(0); i < population_size; ++i) {
+			if (fitness[i] >= members_fitness[i]) {
+				read(genomes[i], &members[i * n]);
+				members_fitness[i] = fitness[i];
+			}
+		}
+	}
+
+	void ask(std::vector<DNA>& genomes) override
+	{
+		std::mt19937& generator = NumberGenerator<>::getInstance().gen;
+		// Not enough members to build trials
+		if (population_size < 4) {
+			for (uint32_t i(0); i < population_size; ++i) {
+				write(&members[i * n], genomes[i]);
+			}
+			return;
+		}
+		for (uint32_t i(0); i < population_size; ++i) {
+			// Three other distinct members
+			uint32_t r[3];
+			for (uint32_t k(0); k < 3; ++k) {
+				do {
+					r[k] = getIntUnder(population_size - 1, generator);
+				} while (r[k] == i || (k > 0 && r[k] == r[0]) || (k > 1 && r[k] == r[1]));
+			}
+			const float* target = &members[i * n];
+			const float* a = &members[r[0] * n];
+			const float* b = &members[r[1] * n];
+			const float* c = &members[r[2] * n];
+			float* trial = &trials[i * n];
+			// At least one parameter comes from the mutant
+			const uint64_t forced = getIntUnder(as<uint32_t>(n - 1), generator);
+			for (uint64_t j(0); j < n; ++j) {
+				const bool cross = j == forced || getRandUnder(1.0f, generator) < crossover_probability;
+				trial[j] = cross ? a[j] + differential_weight * (b[j] - c[j]) : target[j];
+			}
+			write(trial, genomes[i]);
+		}
+	}
+};
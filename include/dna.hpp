@@ -3,7 +3,9 @@
 #include <vector>
 #include <iostream>
 #include <bitset>
+#include <cstring>
 #include "number_generator.hpp"
+#include "utils.hpp"
 
 
 constexpr float MAX_RANGE = 10.0f;
@@ -14,8 +16,33 @@ struct DNA
 	using byte = uint8_t;
 
 	DNA(const uint64_t bits_count)
-		: code(bits_count / 8u + bool(bits_count % 8 && bits_count > 8))
-	{}
+		: bytes_count(0)
+	{
+		resize(bits_count / 8u + bool(bits_count % 8 && bits_count > 8));
+	}
+
+	// The code is stored as whole floats so that networks can read their parameters in place
+	void resize(const uint64_t bytes_count_)
+	{
+		bytes_count = bytes_count_;
+		code.resize((bytes_count + sizeof(float) - 1) / sizeof(float));
+	}
+
+	// Bytes may be read through the floats, the opposite would break aliasing rules
+	byte* getBytes()
+	{
+		return reinterpret_cast<byte*>(code.data());
+	}
+
+	const byte* getBytes() const
+	{
+		return reinterpret_cast<const byte*>(code.data());
+	}
+
+	const float* getFloats() const
+	{
+		return code.data();
+	}
 
 	template<typename T>
 	void initialize(const float range)
@@ -32,7 +59,7 @@ struct DNA
 	{
 		T result;
 		const uint64_t dna_offset = offset * sizeof(T);
-		memcpy(&result, &code[dna_offset], sizeof(T));
+		memcpy(&result, getBytes() + dna_offset, sizeof(T));
 		return result;
 	}
 
@@ -41,35 +68,37 @@ struct DNA
 	{
 		const float checked_value = clamp(-MAX_RANGE, MAX_RANGE, value);
 		const uint64_t dna_offset = offset * sizeof(T);
-		memcpy(&code[dna_offset], &value, sizeof(T));
+		memcpy(getBytes() + dna_offset, &value, sizeof(T));
 	}
 
 	uint64_t getBytesCount() const
 	{
-		return code.size();
+		return bytes_count;
 	}
 
 	template<typename T>
 	uint64_t getElementsCount() const
 	{
-		return code.size() / sizeof(T);
+		return bytes_count / sizeof(T);
 	}
 
 	void print() const
 	{
-		for (const byte word : code) {
-			std::cout << std::bitset<8>(word) << ' ';
+		const byte* bytes = getBytes();
+		for (uint64_t i(0); i < bytes_count; ++i) {
+			std::cout << std::bitset<8>(bytes[i]) << ' ';
 		}
 		std::cout << std::endl;
 	}
 
 	void mutateBits(const float probability)
 	{
-		for (byte& b : code) {
+		byte* bytes = getBytes();
+		for (uint64_t k(0); k < bytes_count; ++k) {
 			for (uint64_t i(0); i < 8; ++i) {
 				if (NumberGenerator<>::getInstance().getUnder(1.0f) < probability) {
 					const uint8_t mask = 256 >> i;
-					b ^= mask;
+					bytes[k] ^= mask;
 				}
 			}
 		}
@@ -78,8 +107,7 @@ struct DNA
 	template<typename T>
 	void mutate(const float probability)
 	{
-		constexpr uint32_t type_size = sizeof(T);
-		const uint64_t element_count = code.size() / type_size;
+		const uint64_t element_count = getElementsCount<T>();
 		for (uint64_t i(0); i < element_count; ++i) {
 			if (NumberGenerator<>::getInstance().getUnder(1.0f) < probability) {
 				const T value = NumberGenerator<>::getInstance().get(MAX_RANGE);
@@ -88,6 +116,18 @@ struct DNA
 		}
 	}
 
+	// FNV-1a over the raw code
+	uint64_t getHash() const
+	{
+		uint64_t hash = 14695981039346656037ull;
+		const byte* bytes = getBytes();
+		for (uint64_t i(0); i < bytes_count; ++i) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
 	bool operator==(const DNA& other) const
 	{
 		const uint64_t code_length = getBytesCount();
@@ -95,8 +135,10 @@ struct DNA
 			return false;
 		}
 
+		const byte* bytes = getBytes();
+		const byte* other_bytes = other.getBytes();
 		for (uint64_t i(0); i < code_length; ++i) {
-			if (code[i] != other.code[i]) {
+			if (bytes[i] != other_bytes[i]) {
 				return false;
 			}
 		}
@@ -104,5 +146,6 @@ struct DNA
 		return true;
 	}
 
-	std::vector<byte> code;
+	std::vector<float> code;
+	uint64_t bytes_count;
 };
@@ -39,7 +39,7 @@ struct DnaLoader
 		}
 
 		infile.seekg(offset * bytes_count, std::ios_base::beg);
-		if (!infile.read((char*)dna.code.data(), bytes_count)) {
+		if (!infile.read((char*)dna.getBytes(), bytes_count)) {
 			std::cout << "Error while reading file." << std::endl;
 		}
 
@@ -49,8 +49,8 @@ struct DnaLoader
 	static void writeDnaToFile(const std::string& filename, const DNA& dna)
 	{
 		std::ofstream outfile(filename, std::istream::out | std::ios::binary | std::ios::app);
-		const uint64_t element_count = dna.code.size();
-		outfile.write((char*)dna.code.data(), element_count);
+		const uint64_t element_count = dna.getBytesCount();
+		outfile.write((const char*)dna.getBytes(), element_count);
 		outfile.close();
 	}
 };
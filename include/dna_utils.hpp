@@ -6,14 +6,14 @@ struct DNAUtils
 {
 	static DNA crossover(const DNA& dna1, const DNA& dna2, const uint64_t cross_point)
 	{
-		const uint64_t code_size = dna1.code.size();
+		const uint64_t code_size = dna1.getBytesCount();
 		DNA result(code_size * 8);
 
 		for (uint64_t i(0); i < cross_point; ++i) {
-			result.code[i] = dna1.code[i];
+			result.getBytes()[i] = dna1.getBytes()[i];
 		}
 		for (uint64_t i(cross_point); i < code_size; ++i) {
-			result.code[i] = dna2.code[i];
+			result.getBytes()[i] = dna2.getBytes()[i];
 		}
 
 		return result;
@@ -22,25 +22,67 @@ struct DNAUtils
 	template<typename T>
 	static DNA makeChild(const DNA& dna1, const DNA& dna2, const float mutation_probability)
 	{
-		const uint64_t point1 = getIntUnderNonReset(as<uint32_t>(dna1.getBytesCount()));
-		DNA child_dna = crossover(dna1, dna2, point1);
+		DNA child_dna(0);
+		makeChild<T>(dna1, dna2, mutation_probability, child_dna);
+		return child_dna;
+	}
+
+	// Writes the child in child_dna's buffer, crossover, scaling and mutation in a single pass
+	template<typename T>
+	static void makeChild(const DNA& dna1, const DNA& dna2, const float mutation_probability, DNA& child_dna)
+	{
+		const uint64_t code_size = dna1.getBytesCount();
+		child_dna.resize(code_size);
+		const uint64_t cross_point = getIntUnderNonReset(as<uint32_t>(code_size));
+		NumberGenerator<>& generator = NumberGenerator<>::getInstance();
 		const uint64_t element_count = dna1.getElementsCount<T>();
 		for (uint64_t i(element_count); i--;) {
-			const float distrib = 1.0f + NumberGenerator<>::getInstance().get(mutation_probability);
-			child_dna.set(i, child_dna.get<float>(i) * distrib);
+			const uint64_t offset = i * sizeof(T);
+			T value;
+			if (offset + sizeof(T) <= cross_point) {
+				value = dna1.get<T>(i);
+			}
+			else if (offset >= cross_point) {
+				value = dna2.get<T>(i);
+			}
+			else {
+				// The cross point can be inside an element
+				uint8_t bytes[sizeof(T)];
+				const uint64_t first_count = cross_point - offset;
+				std::memcpy(bytes, dna1.getBytes() + offset, first_count);
+				std::memcpy(bytes + first_count, dna2.getBytes() + cross_point, sizeof(T) - first_count);
+				std::memcpy(&value, bytes, sizeof(T));
+			}
+			value *= 1.0f + generator.get(mutation_probability);
+			if (generator.getUnder(1.0f) < mutation_probability) {
+				value = generator.get(MAX_RANGE);
+			}
+			child_dna.set(i, value);
 		}
-		child_dna.mutate<float>(mutation_probability);
-		return child_dna;
 	}
 
 	template<typename T>
 	static DNA evolve(const DNA& dna, float mutation_probability, float range)
 	{
-		DNA child_dna = dna;
-		optimize<T>(child_dna, mutation_probability, range);
+		DNA child_dna(0);
+		evolve<T>(dna, mutation_probability, range, child_dna);
 		return child_dna;
 	}
 
+	template<typename T>
+	static void evolve(const DNA& dna, float mutation_probability, float range, DNA& child_dna)
+	{
+		child_dna.resize(dna.getBytesCount());
+		const uint64_t element_count = dna.getElementsCount<T>();
+		for (uint64_t i(element_count); i--;) {
+			T value = dna.get<T>(i);
+			if (pass(mutation_probability)) {
+				value += NumberGenerator<>::getInstance().get(range * MAX_RANGE);
+			}
+			child_dna.set(i, value);
+		}
+	}
+
 	template<typename T>
 	static void optimize(DNA& dna, float probability, float range)
 	{
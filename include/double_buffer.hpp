@@ -1,4 +1,6 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 
 template<typename T>
 struct DoubleObject
@@ -41,3 +43,53 @@ struct DoubleObject
 };
 
 
+
+
+/*
+	Lock free handoff between one writer and one reader, the writer never waits.
+	The writer fills getBack() then publishes it, the reader calls acquire() to
+	get the most recent published buffer in getFront(). Intermediate buffers
+	published while the reader is busy are skipped.
+*/
+template<typename T>
+struct TripleObject
+{
+	TripleObject()
+		: back(0u)
+		, middle(1u)
+		, front(2u)
+	{}
+
+	T& getBack()
+	{
+		return buffers[back];
+	}
+
+	void publish()
+	{
+		back = middle.exchange(back | fresh_flag, std::memory_order_acq_rel) & index_mask;
+	}
+
+	// Returns true if a new buffer was published since the last call
+	bool acquire()
+	{
+		if (!(middle.load(std::memory_order_relaxed) & fresh_flag)) {
+			return false;
+		}
+		front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+		return true;
+	}
+
+	const T& getFront() const
+	{
+		return buffers[front];
+	}
+
+	static constexpr uint8_t fresh_flag = 4u;
+	static constexpr uint8_t index_mask = 3u;
+
+	uint8_t back;
+	std::atomic<uint8_t> middle;
+	uint8_t front;
+	T buffers[3];
+};
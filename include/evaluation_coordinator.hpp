@@ -0,0 +1,293 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <iostream>
+#include <SFML/Network.hpp>
+#include "stadium.hpp"
+#include "evaluation_protocol.hpp"
+
+
+/*
+	Distributes a generation's evaluation to worker processes connected over TCP.
+	The population is cut in batches, each worker has up to pipeline_depth batches in flight
+	so that it starts the next one as soon as it answers. Batches of a worker that disconnects
+	or stops answering are sent again to another one, what can't be evaluated remotely
+	is evaluated by the local stadium.
+*/
+struct EvaluationCoordinator
+{
+	struct Batch
+	{
+		std::vector<uint32_t> genomes;
+		uint32_t retries;
+	};
+
+	struct Worker
+	{
+		std::unique_ptr<sf::TcpSocket> socket;
+		// Batches sent and not answered yet, answers come in the same order
+		std::deque<uint32_t> in_flight;
+		sf::Clock last_activity;
+	};
+
+	sf::TcpListener listener;
+	sf::SocketSelector selector;
+	std::vector<std::unique_ptr<Worker>> workers;
+	uint32_t batch_size;
+	uint32_t pipeline_depth;
+	uint32_t max_retries;
+	// A worker with work that does not answer for this long is considered lost
+	float timeout;
+
+	std::vector<Batch> batches;
+	std::deque<uint32_t> pending;
+	// Neither done nor abandoned
+	uint32_t remaining_count;
+	bool has_abandoned;
+	EvaluationRequest request;
+	EvaluationResult result;
+	sf::Packet packet;
+
+	EvaluationCoordinator()
+		: batch_size(64)
+		, pipeline_depth(2)
+		, max_retries(3)
+		, timeout(120.0f)
+		, remaining_count(0)
+		, has_abandoned(false)
+	{}
+
+	bool listen(unsigned short port)
+	{
+		if (listener.listen(port) != sf::Socket::Done) {
+			return false;
+		}
+		listener.setBlocking(false);
+		return true;
+	}
+
+	uint32_t getWorkersCount() const
+	{
+		return static_cast<uint32_t>(workers.size());
+	}
+
+	void acceptWorkers()
+	{
+		auto socket = std::make_unique<sf::TcpSocket>();
+		while (listener.accept(*socket) == sf::Socket::Done) {
+			selector.add(*socket);
+			workers.push_back(std::make_unique<Worker>());
+			workers.back()->socket = std::move(socket);
+			std::cout << "Worker connected, " << workers.size() << " in total" << std::endl;
+			socket = std::make_unique<sf::TcpSocket>();
+		}
+	}
+
+	bool waitForWorkers(uint32_t count, float max_wait)
+	{
+		sf::Clock clock;
+		while (workers.size() < count && clock.getElapsedTime().asSeconds() < max_wait) {
+			acceptWorkers();
+			sf::sleep(sf::milliseconds(100));
+		}
+		return workers.size() >= count;
+	}
+
+	// Evaluates the genomes of the stadium's current iteration still alive, as update would
+	void evaluate(Stadium& stadium, float dt, float max_time)
+	{
+		acceptWorkers();
+		createBatches(stadium);
+		request.dt = dt;
+		request.max_time = max_time;
+		request.rotation_vectors = stadium.rotation_vectors;
+		request.targets_count = stadium.targets_count;
+		request.physics_variation = stadium.physics_variation;
+		request.area_size = stadium.area_size;
+		request.seeds.resize(stadium.scenarios_count);
+		for (uint32_t k(0); k < stadium.scenarios_count; ++k) {
+			request.seeds[k] = stadium.scenarios[k].seed;
+		}
+
+		while (remaining_count) {
+			acceptWorkers();
+			if (workers.empty()) {
+				// Nobody to send the rest to
+				while (!pending.empty()) {
+					abandon();
+					pending.pop_front();
+				}
+				break;
+			}
+			dispatch(stadium);
+			receive(stadium);
+		}
+
+		// Genomes not evaluated remotely are the only ones still alive
+		if (has_abandoned) {
+			stadium.updateBlocked(dt, stadium.getRemainingSteps(dt, max_time));
+		}
+	}
+
+	void createBatches(const Stadium& stadium)
+	{
+		batches.clear();
+		pending.clear();
+		has_abandoned = false;
+		// Genomes that have all their results in the cache are not sent
+		for (uint32_t i(0); i < stadium.population_size; ++i) {
+			if (!stadium.isAlive(i)) {
+				continue;
+			}
+			if (batches.empty() || batches.back().genomes.size() == batch_size) {
+				batches.push_back({ {}, 0 });
+				pending.push_back(static_cast<uint32_t>(batches.size() - 1));
+			}
+			batches.back().genomes.push_back(i);
+		}
+		remaining_count = static_cast<uint32_t>(batches.size());
+	}
+
+	void abandon()
+	{
+		--remaining_count;
+		has_abandoned = true;
+	}
+
+	void dispatch(const Stadium& stadium)
+	{
+		for (uint64_t w(0); w < workers.size();) {
+			Worker& worker = *workers[w];
+			bool lost = false;
+			while (!pending.empty() && worker.in_flight.size() < pipeline_depth) {
+				const uint32_t batch_id = pending.front();
+				fillRequest(stadium, batch_id);
+				request.write(packet);
+				if (worker.socket->send(packet) != sf::Socket::Done) {
+					lost = true;
+					break;
+				}
+				if (worker.in_flight.empty()) {
+					worker.last_activity.restart();
+				}
+				worker.in_flight.push_back(batch_id);
+				pending.pop_front();
+			}
+			if (lost) {
+				removeWorker(w);
+			}
+			else {
+				++w;
+			}
+		}
+	}
+
+	void fillRequest(const Stadium& stadium, uint32_t batch_id)
+	{
+		const Batch& batch = batches[batch_id];
+		const DNA& first_dna = stadium.getBody(batch.genomes[0], 0).dna;
+		request.batch_id = batch_id;
+		request.parameters_count = static_cast<uint32_t>(first_dna.getBytesCount() / sizeof(float));
+		request.parameters.resize(batch.genomes.size() * request.parameters_count);
+		for (uint64_t i(0); i < batch.genomes.size(); ++i) {
+			const DNA& dna = stadium.getBody(batch.genomes[i], 0).dna;
+			std::memcpy(&request.parameters[i * request.parameters_count], dna.getBytes(), dna.getBytesCount());
+		}
+	}
+
+	void receive(Stadium& stadium)
+	{
+		if (!selector.wait(sf::milliseconds(100))) {
+			checkTimeouts();
+			return;
+		}
+		for (uint64_t w(0); w < workers.size();) {
+			Worker& worker = *workers[w];
+			if (!selector.isReady(*worker.socket)) {
+				++w;
+				continue;
+			}
+			const sf::Socket::Status status = worker.socket->receive(packet);
+			if (status == sf::Socket::Done && result.read(packet) && !worker.in_flight.empty() && worker.in_flight.front() == result.batch_id && isResultValid(stadium)) {
+				worker.in_flight.pop_front();
+				worker.last_activity.restart();
+				applyResult(stadium);
+				++w;
+			}
+			else if (status == sf::Socket::NotReady || status == sf::Socket::Partial) {
+				++w;
+			}
+			else {
+				removeWorker(w);
+			}
+		}
+		checkTimeouts();
+	}
+
+	// A worker that answers with another shape of result is treated as lost
+	bool isResultValid(const Stadium& stadium) const
+	{
+		const uint64_t genomes_count = batches[result.batch_id].genomes.size();
+		return result.scenarios_count == stadium.scenarios_count && result.fitness.size() == genomes_count * stadium.scenarios_count;
+	}
+
+	void applyResult(Stadium& stadium)
+	{
+		Batch& batch = batches[result.batch_id];
+		const uint32_t scenarios_count = stadium.scenarios_count;
+		int64_t deaths_count = 0;
+		for (uint64_t i(0); i < batch.genomes.size(); ++i) {
+			const uint32_t genome = batch.genomes[i];
+			for (uint32_t k(0); k < scenarios_count; ++k) {
+				Rocket& body = stadium.getBody(genome, k);
+				// Cached results are kept
+				if (body.alive) {
+					body.fitness = result.fitness[i * scenarios_count + k];
+					body.time = result.time[i * scenarios_count + k];
+					stadium.getObjective(genome, k).target_id = result.target_id[i * scenarios_count + k];
+					body.alive = false;
+					++deaths_count;
+				}
+			}
+			stadium.checkBestFitness(stadium.getFitness(genome));
+		}
+		if (stadium.live_stats) {
+			stadium.live_stats->addSteps(stadium.getRemoteLane(), result.steps_count, -deaths_count);
+		}
+		--remaining_count;
+	}
+
+	void checkTimeouts()
+	{
+		for (uint64_t w(0); w < workers.size();) {
+			const Worker& worker = *workers[w];
+			if (!worker.in_flight.empty() && worker.last_activity.getElapsedTime().asSeconds() > timeout) {
+				std::cout << "Worker timed out" << std::endl;
+				removeWorker(w);
+			}
+			else {
+				++w;
+			}
+		}
+	}
+
+	// Its batches are sent again, up to max_retries times
+	void removeWorker(uint64_t w)
+	{
+		Worker& worker = *workers[w];
+		for (const uint32_t batch_id : worker.in_flight) {
+			Batch& batch = batches[batch_id];
+			if (++batch.retries > max_retries) {
+				abandon();
+			}
+			else {
+				pending.push_front(batch_id);
+			}
+		}
+		selector.remove(*worker.socket);
+		worker.socket->disconnect();
+		workers.erase(workers.begin() + w);
+		std::cout << "Worker lost, " << workers.size() << " left" << std::endl;
+	}
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include <vector>
+#include <SFML/Network.hpp>
+
+
+/*
+	Messages exchanged between the coordinator and the evaluation workers, one sf::Packet each.
+	A request holds everything needed to rebuild the stadium's episode: scenarios are sent as seeds
+	and genomes as their network parameters. Workers answer in the order requests were received.
+*/
+struct EvaluationRequest
+{
+	static constexpr sf::Uint8 type = 1;
+
+	uint32_t batch_id;
+	float dt;
+	float max_time;
+	bool rotation_vectors;
+	uint32_t targets_count;
+	float physics_variation;
+	sf::Vector2f area_size;
+	std::vector<uint32_t> seeds;
+	uint32_t parameters_count;
+	// Genome major, parameters_count floats per genome
+	std::vector<float> parameters;
+
+	uint32_t getGenomesCount() const
+	{
+		return parameters_count ? static_cast<uint32_t>(parameters.size() / parameters_count) : 0;
+	}
+
+	void write(sf::Packet& packet) const
+	{
+		packet.clear();
+		packet << type << batch_id << dt << max_time << rotation_vectors << targets_count << physics_variation;
+		packet << area_size.x << area_size.y;
+		packet << static_cast<sf::Uint32>(seeds.size());
+		for (const uint32_t seed : seeds) {
+			packet << seed;
+		}
+		packet << parameters_count << static_cast<sf::Uint32>(parameters.size());
+		for (const float p : parameters) {
+			packet << p;
+		}
+	}
+
+	bool read(sf::Packet& packet)
+	{
+		sf::Uint8 packet_type = 0;
+		sf::Uint32 seeds_count = 0;
+		sf::Uint32 values_count = 0;
+		packet >> packet_type >> batch_id >> dt >> max_time >> rotation_vectors >> targets_count >> physics_variation;
+		packet >> area_size.x >> area_size.y >> seeds_count;
+		if (!packet || packet_type != type) {
+			return false;
+		}
+		seeds.resize(seeds_count);
+		for (uint32_t& seed : seeds) {
+			packet >> seed;
+		}
+		packet >> parameters_count >> values_count;
+		if (!packet) {
+			return false;
+		}
+		parameters.resize(values_count);
+		for (float& p : parameters) {
+			packet >> p;
+		}
+		return bool(packet);
+	}
+};
+
+
+struct EvaluationResult
+{
+	static constexpr sf::Uint8 type = 2;
+
+	uint32_t batch_id;
+	uint32_t scenarios_count;
+	// Rocket steps simulated for the batch
+	sf::Uint64 steps_count;
+	// Genome major, the fitness, flight time and targets reached of each scenario
+	std::vector<float> fitness;
+	std::vector<float> time;
+	std::vector<uint32_t> target_id;
+
+	void write(sf::Packet& packet) const
+	{
+		packet.clear();
+		packet << type << batch_id << scenarios_count << steps_count << static_cast<sf::Uint32>(fitness.size());
+		for (uint64_t i(0); i < fitness.size(); ++i) {
+			packet << fitness[i] << time[i] << target_id[i];
+		}
+	}
+
+	bool read(sf::Packet& packet)
+	{
+		sf::Uint8 packet_type = 0;
+		sf::Uint32 values_count = 0;
+		packet >> packet_type >> batch_id >> scenarios_count >> steps_count >> values_count;
+		if (!packet || packet_type != type) {
+			return false;
+		}
+		fitness.resize(values_count);
+		time.resize(values_count);
+		target_id.resize(values_count);
+		for (uint32_t i(0); i < values_count; ++i) {
+			packet >> fitness[i] >> time[i] >> target_id[i];
+		}
+		return bool(packet);
+	}
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <memory>
+#include <iostream>
+#include <SFML/Network.hpp>
+#include "stadium.hpp"
+#include "evaluation_protocol.hpp"
+
+
+/*
+	Process side of the distributed evaluation: receives genome batches from a coordinator,
+	evaluates them with a local stadium and sends back their fitness.
+*/
+struct EvaluationWorker
+{
+	// 0 for one per physical core
+	uint32_t threads;
+	bool pin_threads;
+	// Sized for the largest batch received so far, smaller batches leave genomes unused
+	std::unique_ptr<Stadium> stadium;
+	DNA dna;
+
+	EvaluationWorker(uint32_t threads_, bool pin_threads_ = false)
+		: threads(threads_)
+		, pin_threads(pin_threads_)
+		, dna(0)
+	{}
+
+	// Genomes must have the parameters of the local network, the coordinator may run another build
+	static bool isRequestValid(const EvaluationRequest& request)
+	{
+		const uint64_t parameters_count = Network::getParametersCount(architecture);
+		return request.parameters_count == parameters_count
+			&& !request.parameters.empty()
+			&& request.parameters.size() % parameters_count == 0
+			&& !request.seeds.empty();
+	}
+
+	// The request has to be valid
+	void evaluate(const EvaluationRequest& request, EvaluationResult& result)
+	{
+		const uint32_t genomes_count = request.getGenomesCount();
+		const uint32_t scenarios_count = static_cast<uint32_t>(request.seeds.size());
+		if (!stadium || stadium->population_size < genomes_count || stadium->scenarios_count != scenarios_count || stadium->area_size != request.area_size) {
+			stadium = std::make_unique<Stadium>(genomes_count, request.area_size, scenarios_count, threads, pin_threads);
+		}
+
+		Stadium& s = *stadium;
+		s.rotation_vectors = request.rotation_vectors;
+		s.targets_count = request.targets_count;
+		s.physics_variation = request.physics_variation;
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			s.scenarios[k].generate(request.seeds[k], s.area_size, s.targets_count, s.physics_variation);
+		}
+
+		std::vector<Rocket>& population = s.selector.getCurrentPopulation();
+		dna.resize(request.parameters_count * sizeof(float));
+		for (uint32_t i(0); i < genomes_count; ++i) {
+			std::memcpy(dna.getBytes(), &request.parameters[i * request.parameters_count], dna.getBytesCount());
+			population[i].loadDNA(dna);
+		}
+
+		s.current_iteration.reset();
+		s.initializeUnits();
+		for (uint32_t i(genomes_count); i < s.population_size; ++i) {
+			for (uint32_t k(0); k < scenarios_count; ++k) {
+				s.getBody(i, k).alive = false;
+			}
+		}
+		s.updateBlocked(request.dt, s.getRemainingSteps(request.dt, request.max_time));
+
+		result.batch_id = request.batch_id;
+		result.scenarios_count = scenarios_count;
+		result.steps_count = 0;
+		result.fitness.resize(genomes_count * scenarios_count);
+		result.time.resize(genomes_count * scenarios_count);
+		result.target_id.resize(genomes_count * scenarios_count);
+		for (uint32_t i(0); i < genomes_count; ++i) {
+			for (uint32_t k(0); k < scenarios_count; ++k) {
+				const Rocket& body = s.getBody(i, k);
+				result.fitness[i * scenarios_count + k] = body.fitness;
+				result.time[i * scenarios_count + k] = body.time;
+				result.target_id[i * scenarios_count + k] = s.getObjective(i, k).target_id;
+				// Rockets advance their time by dt at each step they are alive
+				result.steps_count += std::lround(body.time / request.dt);
+			}
+		}
+	}
+
+	// Serves a coordinator until it disconnects, returns false if it could not be reached
+	bool run(const sf::IpAddress& address, unsigned short port, float connection_timeout = 30.0f)
+	{
+		sf::TcpSocket socket;
+		sf::Clock clock;
+		// The coordinator may not be listening yet
+		while (socket.connect(address, port, sf::seconds(1.0f)) != sf::Socket::Done) {
+			if (clock.getElapsedTime().asSeconds() > connection_timeout) {
+				std::cerr << "Cannot reach coordinator on port " << port << std::endl;
+				return false;
+			}
+			sf::sleep(sf::milliseconds(500));
+		}
+		std::cout << "Connected to coordinator on port " << port << std::endl;
+
+		sf::Packet packet;
+		EvaluationRequest request;
+		EvaluationResult result;
+		uint32_t batches_count = 0;
+		while (socket.receive(packet) == sf::Socket::Done) {
+			if (!request.read(packet) || !isRequestValid(request)) {
+				std::cerr << "Invalid request" << std::endl;
+				break;
+			}
+			evaluate(request, result);
+			result.write(packet);
+			if (socket.send(packet) != sf::Socket::Done) {
+				break;
+			}
+			++batches_count;
+		}
+		std::cout << "Coordinator gone after " << batches_count << " batches" << std::endl;
+		return true;
+	}
+};
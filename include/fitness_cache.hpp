@@ -0,0 +1,74 @@
+#pragma once
+#include <unordered_map>
+#include <cstdint>
+
+
+/*
+	Stores the result obtained by a genome on a scenario so that identical
+	genomes evaluated again on the same scenario don't need to be simulated
+*/
+struct FitnessCache
+{
+	// What is known of a rocket once its episode is over
+	struct Entry
+	{
+		float fitness;
+		float time;
+		uint32_t target_id;
+	};
+
+	struct Key
+	{
+		uint64_t genome_hash;
+		uint32_t scenario_seed;
+
+		bool operator==(const Key& other) const
+		{
+			return genome_hash == other.genome_hash && scenario_seed == other.scenario_seed;
+		}
+	};
+
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& key) const
+		{
+			return static_cast<std::size_t>(key.genome_hash ^ (key.scenario_seed * 0x9E3779B97F4A7C15ull));
+		}
+	};
+
+	uint64_t max_size;
+	std::unordered_map<Key, Entry, KeyHash> entries;
+
+	FitnessCache(uint64_t max_entries = 1u << 20)
+		: max_size(max_entries)
+	{}
+
+	bool get(uint64_t genome_hash, uint32_t scenario_seed, Entry& entry) const
+	{
+		const auto it = entries.find(Key{ genome_hash, scenario_seed });
+		if (it == entries.end()) {
+			return false;
+		}
+
+		entry = it->second;
+		return true;
+	}
+
+	void add(uint64_t genome_hash, uint32_t scenario_seed, const Entry& entry)
+	{
+		if (entries.size() >= max_size) {
+			entries.clear();
+		}
+		entries[Key{ genome_hash, scenario_seed }] = entry;
+	}
+
+	void clear()
+	{
+		entries.clear();
+	}
+
+	uint64_t size() const
+	{
+		return entries.size();
+	}
+};
@@ -0,0 +1,305 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <SFML/Graphics.hpp>
+#include <swarm.hpp>
+#include "rocket_renderer.hpp"
+#include "replay.hpp"
+
+#ifdef _WIN32
+	#define popen _popen
+	#define pclose _pclose
+#endif
+
+
+/*
+	Minimal CPU rasterizer, flat colored triangles with alpha blending into an RGB buffer.
+	Triangles are queued then rasterized by horizontal bands, one band per worker.
+*/
+struct SoftwareCanvas
+{
+	struct Triangle
+	{
+		sf::Vector2f points[3];
+		sf::Color color;
+	};
+
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+	std::vector<Triangle> triangles;
+	sf::Color background;
+	// World to pixels: (p - origin) * zoom
+	sf::Vector2f origin;
+	float zoom;
+
+	SoftwareCanvas(uint32_t width_, uint32_t height_)
+		: width(width_)
+		, height(height_)
+		, pixels(3 * width_ * height_)
+		, background(sf::Color::Black)
+		, zoom(1.0f)
+	{}
+
+	sf::Vector2f toPixels(sf::Vector2f p) const
+	{
+		return (p - origin) * zoom;
+	}
+
+	void clear()
+	{
+		triangles.clear();
+	}
+
+	// Coordinates are in world space unless screen_space is set
+	void addTriangle(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, sf::Color color, bool screen_space = false)
+	{
+		if (screen_space) {
+			triangles.push_back({ { a, b, c }, color });
+		}
+		else {
+			triangles.push_back({ { toPixels(a), toPixels(b), toPixels(c) }, color });
+		}
+	}
+
+	void addQuad(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, sf::Vector2f d, sf::Color color, bool screen_space = false)
+	{
+		addTriangle(a, b, c, color, screen_space);
+		addTriangle(a, c, d, color, screen_space);
+	}
+
+	void addPie(sf::Vector2f center, float radius, float angle, sf::Color color, uint32_t quality = 24)
+	{
+		const float da = angle / float(quality);
+		for (uint32_t i(0); i < quality; ++i) {
+			const sf::Vector2f p1 = center + radius * sf::Vector2f(cos(i * da), sin(i * da));
+			const sf::Vector2f p2 = center + radius * sf::Vector2f(cos((i + 1) * da), sin((i + 1) * da));
+			addTriangle(center, p1, p2, color);
+		}
+	}
+
+	void addCircle(sf::Vector2f center, float radius, sf::Color color, uint32_t quality = 24)
+	{
+		addPie(center, radius, 2.0f * PI, color, quality);
+	}
+
+	void rasterize(swrm::Swarm* swarm = nullptr)
+	{
+		if (swarm) {
+			auto group = swarm->execute([&](uint32_t thread_id, uint32_t max_thread) {
+				const uint32_t band_height = height / max_thread;
+				const uint32_t end = (thread_id + 1 == max_thread) ? height : (thread_id + 1) * band_height;
+				rasterizeBand(thread_id * band_height, end);
+			});
+			group.waitExecutionDone();
+		}
+		else {
+			rasterizeBand(0, height);
+		}
+	}
+
+	void rasterizeBand(uint32_t y_begin, uint32_t y_end)
+	{
+		for (uint32_t y(y_begin); y < y_end; ++y) {
+			uint8_t* row = &pixels[3 * y * width];
+			for (uint32_t x(0); x < width; ++x) {
+				row[3 * x + 0] = background.r;
+				row[3 * x + 1] = background.g;
+				row[3 * x + 2] = background.b;
+			}
+		}
+
+		for (const Triangle& t : triangles) {
+			const sf::Vector2f& a = t.points[0];
+			const sf::Vector2f& b = t.points[1];
+			const sf::Vector2f& c = t.points[2];
+			const float area = edge(a, b, c);
+			if (area == 0.0f) {
+				continue;
+			}
+
+			const int32_t min_x = std::max(0, int32_t(std::floor(std::min({ a.x, b.x, c.x }))));
+			const int32_t max_x = std::min(int32_t(width) - 1, int32_t(std::ceil(std::max({ a.x, b.x, c.x }))));
+			const int32_t min_y = std::max(int32_t(y_begin), int32_t(std::floor(std::min({ a.y, b.y, c.y }))));
+			const int32_t max_y = std::min(int32_t(y_end) - 1, int32_t(std::ceil(std::max({ a.y, b.y, c.y }))));
+			// Same test for both windings
+			const float orientation = area > 0.0f ? 1.0f : -1.0f;
+			const uint32_t alpha = t.color.a;
+			for (int32_t y(min_y); y <= max_y; ++y) {
+				for (int32_t x(min_x); x <= max_x; ++x) {
+					const sf::Vector2f p(x + 0.5f, y + 0.5f);
+					if (orientation * edge(a, b, p) < 0.0f || orientation * edge(b, c, p) < 0.0f || orientation * edge(c, a, p) < 0.0f) {
+						continue;
+					}
+					uint8_t* pixel = &pixels[3 * (y * width + x)];
+					pixel[0] = blend(pixel[0], t.color.r, alpha);
+					pixel[1] = blend(pixel[1], t.color.g, alpha);
+					pixel[2] = blend(pixel[2], t.color.b, alpha);
+				}
+			}
+		}
+	}
+
+	static float edge(sf::Vector2f a, sf::Vector2f b, sf::Vector2f p)
+	{
+		return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+	}
+
+	static uint8_t blend(uint8_t dst, uint8_t src, uint32_t alpha)
+	{
+		return static_cast<uint8_t>((src * alpha + dst * (255 - alpha)) / 255);
+	}
+};
+
+
+/*
+	Draws simulation states without any window and writes them either as a PPM
+	sequence or as raw RGB24 frames to a pipe, for instance
+	ffmpeg -f rawvideo -pix_fmt rgb24 -s 1280x720 -r 30 -i - flight.mp4
+*/
+struct FrameExporter
+{
+	SoftwareCanvas canvas;
+	std::string sequence_prefix;
+	FILE* pipe;
+	uint64_t frames_count;
+	swrm::Swarm* swarm;
+
+	FrameExporter(uint32_t width, uint32_t height, swrm::Swarm* swarm_ = nullptr)
+		: canvas(width, height)
+		, pipe(nullptr)
+		, frames_count(0)
+		, swarm(swarm_)
+	{
+		// Same framing as the window
+		canvas.origin = sf::Vector2f(160.0f, 90.0f);
+		canvas.zoom = 1.2f * width / 1600.0f;
+		canvas.background = sf::Color(20, 20, 20);
+	}
+
+	~FrameExporter()
+	{
+		close();
+	}
+
+	// Frames are written as prefix_000000.ppm, prefix_000001.ppm...
+	void openSequence(const std::string& prefix)
+	{
+		close();
+		sequence_prefix = prefix;
+		frames_count = 0;
+	}
+
+	bool openPipe(const std::string& command)
+	{
+		close();
+		pipe = popen(command.c_str(), "w");
+		frames_count = 0;
+		return pipe != nullptr;
+	}
+
+	void close()
+	{
+		if (pipe) {
+			pclose(pipe);
+			pipe = nullptr;
+		}
+		sequence_prefix.clear();
+	}
+
+	bool isOpen() const
+	{
+		return pipe || !sequence_prefix.empty();
+	}
+
+	void drawRocket(const RocketState& rocket)
+	{
+		if (!rocket.alive) {
+			return;
+		}
+		const sf::Vector2f d = rocket.direction;
+		const sf::Vector2f n(-d.y, d.x);
+		const float half_length = 0.5f * RocketRenderer::body_scale * rocket.height;
+		const float half_width = 0.5f * RocketRenderer::body_scale * RocketRenderer::body_width;
+
+		// Flame first so the body is drawn over it
+		const sf::Vector2f nozzle = rocket.position + 0.5f * rocket.height * d;
+		const sf::Vector2f flame_n(-rocket.thruster_direction.y, rocket.thruster_direction.x);
+		const float flame_length = RocketRenderer::thruster_height + 150.0f * rocket.avg_power;
+		canvas.addTriangle(nozzle + 8.0f * flame_n, nozzle - 8.0f * flame_n, nozzle + flame_length * rocket.thruster_direction, sf::Color(255, 160, 40, 200));
+
+		canvas.addQuad(rocket.position - half_length * d - half_width * n,
+		               rocket.position + half_length * d - half_width * n,
+		               rocket.position + half_length * d + half_width * n,
+		               rocket.position - half_length * d + half_width * n,
+		               sf::Color(230, 230, 230));
+	}
+
+	void drawTarget(sf::Vector2f position, float time_in, bool visible)
+	{
+		const float target_radius = 10.0f;
+		if (visible) {
+			canvas.addCircle(position, target_radius, sf::Color(255, 128, 0));
+		}
+		canvas.addPie(position, target_radius - 3.0f, (time_in / 3.0f) * 2.0f * PI, sf::Color(75, 75, 75));
+	}
+
+	// Bar chart in the bottom left corner, in pixels
+	void drawChart(const std::vector<float>& values)
+	{
+		if (values.empty()) {
+			return;
+		}
+		const float margin = 10.0f;
+		const float chart_width = 0.45f * canvas.width;
+		const float chart_height = 0.13f * canvas.height;
+		const float max_value = *std::max_element(values.begin(), values.end());
+		const float hf = max_value > 0.0f ? chart_height / max_value : 0.0f;
+		const float bw = chart_width / float(values.size());
+		const float bottom = canvas.height - margin;
+		const sf::Color color(96, 211, 148);
+		for (uint64_t i(0); i < values.size(); ++i) {
+			const float left = margin + i * bw;
+			const float top = bottom - values[i] * hf;
+			canvas.addQuad(sf::Vector2f(left, bottom), sf::Vector2f(left + bw, bottom), sf::Vector2f(left + bw, top), sf::Vector2f(left, top), color, true);
+		}
+	}
+
+	// Rasterizes the queued shapes and writes the frame
+	void writeFrame()
+	{
+		canvas.rasterize(swarm);
+		canvas.clear();
+		if (pipe) {
+			std::fwrite(canvas.pixels.data(), 1, canvas.pixels.size(), pipe);
+		}
+		else if (!sequence_prefix.empty()) {
+			char index[16];
+			std::snprintf(index, sizeof(index), "_%06llu.ppm", static_cast<unsigned long long>(frames_count));
+			std::ofstream outfile(sequence_prefix + index, std::ios::out | std::ios::binary);
+			outfile << "P6\n" << canvas.width << " " << canvas.height << "\n255\n";
+			outfile.write(reinterpret_cast<const char*>(canvas.pixels.data()), canvas.pixels.size());
+		}
+		++frames_count;
+	}
+
+	// Whole flight at the given frame rate
+	void exportReplay(Replay& replay, float fps, const std::vector<float>& fitness_history, uint32_t targets_count)
+	{
+		RocketState state;
+		const float duration = replay.getDuration();
+		for (float time(0.0f); time <= duration; time += 1.0f / fps) {
+			replay.seek(time);
+			const std::vector<sf::Vector2f>& targets = replay.scenario.targets;
+			const uint32_t target_id = std::min(replay.objective.target_id, as<uint32_t>(targets.size() - 1));
+			drawTarget(targets[target_id], replay.objective.time_in, target_id < targets_count - 1);
+			state.set(replay.rocket);
+			drawRocket(state);
+			drawChart(fitness_history);
+			writeFrame();
+		}
+	}
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "rocket_renderer.hpp"
+#include "density_grid.hpp"
+
+
+// Everything the render thread needs to draw a frame, copied from the simulation
+struct FrameSnapshot
+{
+	// As many as the fitness graph displays
+	static constexpr uint32_t kept_bests_count = 1000;
+
+	// Swarm view, only filled when it is displayed
+	bool swarm_view;
+	std::vector<RocketState> rockets;
+
+	// Heatmap view replaces the swarm view, the focused rocket is drawn on top
+	bool heatmap_view;
+	std::vector<float> heatmap;
+	uint32_t heatmap_width;
+	uint32_t heatmap_height;
+
+	// Detailed view of one rocket, or only its gauges in swarm view
+	bool has_focused_rocket;
+	Rocket focused_rocket;
+	std::vector<SmokeSystem::Particle> smoke;
+	bool draw_details;
+
+	bool draw_target;
+	// The last target is only a landing spot and is not drawn
+	bool target_visible;
+	sf::Vector2f target;
+	float time_in;
+
+	bool draw_network;
+	Network network;
+	// The network's own copy of its parameters, the population's can change meanwhile
+	std::vector<float> network_parameters;
+	// Input and values of the network, see Network::execute
+	std::vector<float> network_state;
+
+	// HUD
+	uint32_t generation;
+	float best_fitness;
+	// Bests of the last finished generations, the last one is generation - 1
+	std::vector<float> generation_bests;
+	bool draw_fitness;
+	bool draw_profiler;
+	std::string profiler_text;
+
+	FrameSnapshot()
+		: swarm_view(false)
+		, heatmap_view(false)
+		, heatmap_width(0)
+		, heatmap_height(0)
+		, has_focused_rocket(false)
+		, focused_rocket(Rocket::Replica())
+		, draw_details(false)
+		, draw_target(false)
+		, target_visible(false)
+		, time_in(0.0f)
+		, draw_network(false)
+		, generation(0)
+		, best_fitness(0.0f)
+		, draw_fitness(false)
+		, draw_profiler(false)
+	{}
+};
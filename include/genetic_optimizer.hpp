@@ -0,0 +1,60 @@
+#pragma once
+#include "optimizer.hpp"
+#include "dna_utils.hpp"
+#include "selection_wheel.hpp"
+#include "selector.hpp"
+
+
+// The selector's genetic algorithm behind the optimizer interface
+struct GeneticOptimizer : Optimizer
+{
+	struct Parent
+	{
+		DNA dna;
+		float fitness;
+	};
+
+	std::vector<Parent> parents;
+	std::vector<uint32_t> order;
+
+	GeneticOptimizer() = default;
+
+	const char* getName() const override
+	{
+		return "ga";
+	}
+
+	void tell(const std::vector<DNA>& genomes, const std::vector<float>& fitness) override
+	{
+		// Only the best ones can reproduce
+		sortIndexes(fitness, order);
+		const uint32_t survivings_count = std::max(1u, as<uint32_t>(genomes.size() * population_conservation_ratio));
+		parents.clear();
+		for (uint32_t i(0); i < survivings_count; ++i) {
+			parents.push_back({ genomes[order[i]], fitness[order[i]] });
+		}
+	}
+
+	void ask(std::vector<DNA>& genomes) override
+	{
+		const uint32_t population_size = as<uint32_t>(genomes.size());
+		const uint32_t elites_count = std::min(as<uint32_t>(parents.size()), as<uint32_t>(population_size * population_elite_ratio));
+		SelectionWheel wheel(parents.size());
+		wheel.addFitnessScores(parents);
+
+		for (uint32_t i(0); i < elites_count; ++i) {
+			genomes[i] = parents[i].dna;
+		}
+		for (uint32_t i(elites_count); i < population_size; ++i) {
+			const Parent& parent_1 = wheel.pick(parents);
+			const Parent& parent_2 = wheel.pick(parents);
+			const float mutation_proba = 1.0f / sqrt(parent_1.fitness + parent_2.fitness);
+			if (parent_1.dna == parent_2.dna) {
+				DNAUtils::evolve<float>(parent_1.dna, mutation_proba, mutation_proba, genomes[i]);
+			}
+			else {
+				DNAUtils::makeChild<float>(parent_1.dna, parent_2.dna, mutation_proba, genomes[i]);
+			}
+		}
+	}
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include "utils.hpp"
 
 
 struct Graphic
@@ -16,9 +17,17 @@ struct Graphic
 	uint32_t current_index;
 	bool full;
 
+	// Vertices are stored in values order with one unit per bar and unscaled heights,
+	// wraparound and scaling are done by the transform.
+	// A bar is queued once until the next render, the list stays bounded while hidden
+	std::vector<uint32_t> dirty;
+	std::vector<uint8_t> is_dirty;
+	sf::Color vertices_color;
+
 	Graphic(uint32_t values_count, sf::Vector2f size, sf::Vector2f position)
 		: va(sf::Quads, values_count * 4)
 		, values(values_count, 0.0f)
+		, is_dirty(values_count, 0)
 		, max_value(0.0f)
 		, width(size.x)
 		, height(size.y)
@@ -28,13 +37,21 @@ struct Graphic
 		, current_index(0)
 		, full(false)
 	{
+		for (uint32_t i(0); i < values_count; ++i) {
+			const float left = float(i);
+			const float right = float(i + 1);
+			va[4 * i + 0].position = sf::Vector2f(left , 0.0f);
+			va[4 * i + 1].position = sf::Vector2f(right, 0.0f);
+			va[4 * i + 2].position = sf::Vector2f(right, 0.0f);
+			va[4 * i + 3].position = sf::Vector2f(left , 0.0f);
+		}
+		setColor(color);
 	}
 
 	void addValue(float value)
 	{
 		const uint64_t size = values.size();
-		values[(current_index++) % size] = value;
-		max_value = std::max(max_value, value);
+		setValue(current_index++ % size, value);
 		if (current_index == size) {
 			full = true;
 		}
@@ -51,32 +68,62 @@ struct Graphic
 
 	void setLastValue(float value)
 	{
-		const uint64_t size = values.size();
-		values[current_index % size] = value;
+		setValue(current_index % values.size(), value);
+	}
+
+	void setValue(uint64_t index, float value)
+	{
+		if (values[index] != value) {
+			values[index] = value;
+			if (!is_dirty[index]) {
+				is_dirty[index] = 1;
+				dirty.push_back(as<uint32_t>(index));
+			}
+		}
 		max_value = std::max(max_value, value);
 	}
 
+	void setColor(sf::Color new_color)
+	{
+		const uint64_t count = va.getVertexCount();
+		for (uint64_t i(0); i < count; ++i) {
+			va[i].color = new_color;
+		}
+		vertices_color = new_color;
+	}
+
 	void render(sf::RenderTarget& target)
 	{
+		if (color != vertices_color) {
+			setColor(color);
+		}
+		// Only the bars that changed are written
+		for (const uint32_t i : dirty) {
+			va[4 * i + 2].position.y = values[i];
+			va[4 * i + 3].position.y = values[i];
+			is_dirty[i] = 0;
+		}
+		dirty.clear();
+
 		const uint64_t size = values.size();
 		const float bw = width / float(size);
-		const float hf = height / max_value;
-		for (uint64_t i(0); i < size; ++i) {
-			const uint64_t index = full ? (current_index + 1 + i) % size : i;
-			const float bh = values[index] * hf;
-			va[4 * i + 0].position = sf::Vector2f(x + i * bw      , y + height);
-			va[4 * i + 1].position = sf::Vector2f(x + (i + 1) * bw, y + height);
-			va[4 * i + 2].position = sf::Vector2f(x + (i + 1) * bw, y + height - bh);
-			va[4 * i + 3].position = sf::Vector2f(x + i * bw      , y + height - bh);
+		const float hf = max_value > 0.0f ? height / max_value : 0.0f;
+		sf::RenderStates states;
+		states.transform.translate(x, y + height);
+		states.transform.scale(bw, -hf);
 
-			va[4 * i + 0].color = color;
-			va[4 * i + 1].color = color;
-			va[4 * i + 2].color = color;
-			va[4 * i + 3].color = color;
+		if (!full) {
+			target.draw(va, states);
+			return;
 		}
 
-		target.draw(va);
+		// Oldest values first, the buffer is drawn in two parts moved to their place
+		const uint64_t first = (current_index + 1) % size;
+		sf::RenderStates oldest = states;
+		oldest.transform.translate(-float(first), 0.0f);
+		target.draw(&va[4 * first], 4 * (size - first), sf::Quads, oldest);
+		sf::RenderStates newest = states;
+		newest.transform.translate(float(size - first), 0.0f);
+		target.draw(&va[0], 4 * first, sf::Quads, newest);
 	}
 };
-
-
@@ -0,0 +1,197 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include "profiler.hpp"
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+
+/*
+	Metrics of a running training, rewritten as a small JSON file every period by a background
+	thread so that many headless runs can be watched without a window. The simulation only
+	does relaxed atomic stores: each worker counts its steps and deaths in its own lane,
+	generation level values are published by the main thread between generations.
+*/
+struct LiveStats
+{
+	struct alignas(64) Lane
+	{
+		// Rocket steps simulated
+		std::atomic<uint64_t> steps;
+		// Rockets that started minus the ones that died
+		std::atomic<int64_t> alive_delta;
+
+		Lane()
+			: steps(0)
+			, alive_delta(0)
+		{}
+
+		Lane(const Lane& other)
+			: steps(other.steps.load(std::memory_order_relaxed))
+			, alive_delta(other.alive_delta.load(std::memory_order_relaxed))
+		{}
+	};
+
+	std::vector<Lane> lanes;
+	std::atomic<uint32_t> generation;
+	std::atomic<float> best_fitness;
+	std::atomic<float> mean_fitness;
+	std::atomic<uint64_t> evaluations_count;
+	std::atomic<int64_t> alive_base;
+	std::atomic<uint64_t> genomes_bytes;
+	// Milliseconds of the last generation, only filled when the profiler is enabled
+	std::array<std::atomic<float>, Profiler::PhasesCount> phases_ms;
+
+	std::string filename;
+	float period;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool running;
+	uint64_t last_steps;
+	Profiler::Clock::time_point start;
+	Profiler::Clock::time_point last_write;
+
+	// One lane per worker
+	LiveStats(const std::string& filename_, uint32_t lanes_count, float period_ = 1.0f)
+		: lanes(lanes_count)
+		, generation(0)
+		, best_fitness(0.0f)
+		, mean_fitness(0.0f)
+		, evaluations_count(0)
+		, alive_base(0)
+		, genomes_bytes(0)
+		, filename(filename_)
+		, period(period_)
+		, running(true)
+		, last_steps(0)
+		, start(Profiler::Clock::now())
+		, last_write(start)
+	{
+		for (std::atomic<float>& ms : phases_ms) {
+			ms.store(0.0f, std::memory_order_relaxed);
+		}
+		writer = std::thread(&LiveStats::run, this);
+	}
+
+	~LiveStats()
+	{
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			running = false;
+		}
+		condition.notify_one();
+		writer.join();
+	}
+
+	// Single writer per lane, no need for atomic increments
+	void addSteps(uint32_t lane_id, uint64_t steps, int64_t alive_delta)
+	{
+		Lane& lane = lanes[lane_id];
+		lane.steps.store(lane.steps.load(std::memory_order_relaxed) + steps, std::memory_order_relaxed);
+		lane.alive_delta.store(lane.alive_delta.load(std::memory_order_relaxed) + alive_delta, std::memory_order_relaxed);
+	}
+
+	// Called while workers are idle
+	void setAliveCount(uint64_t count)
+	{
+		int64_t delta = 0;
+		for (const Lane& lane : lanes) {
+			delta += lane.alive_delta.load(std::memory_order_relaxed);
+		}
+		alive_base.store(int64_t(count) - delta, std::memory_order_relaxed);
+	}
+
+	void publishGeneration(uint32_t generation_, float best, float mean, uint64_t evaluations)
+	{
+		generation.store(generation_, std::memory_order_relaxed);
+		best_fitness.store(best, std::memory_order_relaxed);
+		mean_fitness.store(mean, std::memory_order_relaxed);
+		evaluations_count.store(evaluations, std::memory_order_relaxed);
+	}
+
+	void publishTimings(const Profiler::Row& row)
+	{
+		for (uint32_t i(0); i < Profiler::PhasesCount; ++i) {
+			phases_ms[i].store(static_cast<float>(row.milliseconds[i]), std::memory_order_relaxed);
+		}
+	}
+
+	static uint64_t getResidentBytes()
+	{
+#ifdef __linux__
+		std::ifstream statm("/proc/self/statm");
+		uint64_t total_pages = 0;
+		uint64_t resident_pages = 0;
+		if (statm >> total_pages >> resident_pages) {
+			return resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+		}
+#endif
+		return 0;
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> ul(mutex);
+		while (running) {
+			condition.wait_for(ul, std::chrono::milliseconds(static_cast<int64_t>(period * 1000.0f)));
+			ul.unlock();
+			write();
+			ul.lock();
+		}
+		// Final state of the run
+		write();
+	}
+
+	void write()
+	{
+		uint64_t steps = 0;
+		int64_t alive = alive_base.load(std::memory_order_relaxed);
+		for (const Lane& lane : lanes) {
+			steps += lane.steps.load(std::memory_order_relaxed);
+			alive += lane.alive_delta.load(std::memory_order_relaxed);
+		}
+		const Profiler::Clock::time_point now = Profiler::Clock::now();
+		const double elapsed = std::chrono::duration<double>(now - last_write).count();
+		const double steps_per_second = elapsed > 0.0 ? double(steps - last_steps) / elapsed : 0.0;
+		last_steps = steps;
+		last_write = now;
+
+		// Written aside then renamed so that readers never see a partial file
+		const std::string temporary = filename + ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+			file << "{\n";
+			file << "  \"uptime_s\": " << std::chrono::duration<double>(now - start).count() << ",\n";
+			file << "  \"generation\": " << generation.load(std::memory_order_relaxed) << ",\n";
+			file << "  \"best_fitness\": " << best_fitness.load(std::memory_order_relaxed) << ",\n";
+			file << "  \"mean_fitness\": " << mean_fitness.load(std::memory_order_relaxed) << ",\n";
+			file << "  \"evaluations\": " << evaluations_count.load(std::memory_order_relaxed) << ",\n";
+			file << "  \"alive\": " << std::max(int64_t(0), alive) << ",\n";
+			file << "  \"steps\": " << steps << ",\n";
+			file << "  \"steps_per_second\": " << steps_per_second << ",\n";
+			file << "  \"genomes_bytes\": " << genomes_bytes.load(std::memory_order_relaxed) << ",\n";
+			file << "  \"resident_bytes\": " << getResidentBytes() << ",\n";
+			file << "  \"phases_ms\": {";
+			for (uint32_t i(0); i < Profiler::PhasesCount; ++i) {
+				file << (i ? ", " : " ") << "\"" << Profiler::getPhaseName(i) << "\": " << phases_ms[i].load(std::memory_order_relaxed);
+			}
+			file << " }\n}\n";
+		}
+		if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+			// Windows does not replace existing files
+			std::remove(filename.c_str());
+			std::rename(temporary.c_str(), filename.c_str());
+		}
+	}
+};
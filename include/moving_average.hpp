@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <vector>
+#include <algorithm>
 
 struct MovingAverage
 {
@@ -26,7 +27,42 @@ struct MovingAverage
 		++index;
 	}
 
+	// Sets the average as if value had been added over and over
+	void set(float value)
+	{
+		std::fill(values.begin(), values.end(), value);
+		sum = value * float(over);
+		index = over;
+	}
+
 	float get() const {
 		return sum / float(over);
 	}
-};
\ No newline at end of file
+};
+
+
+// O(1) memory alternative, the weight is chosen to match the response of a MovingAverage over count values
+struct ExponentialAverage
+{
+	float weight;
+	float value;
+
+	ExponentialAverage(uint32_t count)
+		: weight(2.0f / float(count + 1))
+		, value(0.0f)
+	{}
+
+	void addValue(float f)
+	{
+		value += weight * (f - value);
+	}
+
+	void set(float value_)
+	{
+		value = value_;
+	}
+
+	float get() const {
+		return value;
+	}
+};
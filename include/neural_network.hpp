@@ -1,121 +1,237 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <iostream>
 #include "utils.hpp"
 
 
 struct Layer
 {
-	Layer(const uint64_t neurons_count, const uint64_t prev_count)
-		: weights(neurons_count)
-		, values(neurons_count)
-		, bias(neurons_count)
-	{
-		for (std::vector<float>& v : weights) {
-			v.resize(prev_count);
-		}
-	}
+	Layer(const uint64_t neurons_count_, const uint64_t prev_count, const uint64_t parameters_offset_, const uint64_t values_offset_)
+		: inputs_count(prev_count)
+		, neurons_count(neurons_count_)
+		, parameters_offset(parameters_offset_)
+		, values_offset(values_offset_)
+	{}
 
 	uint64_t getNeuronsCount() const
 	{
-		return bias.size();
+		return neurons_count;
 	}
 
 	uint64_t getWeightsCount() const
 	{
-		return weights.front().size();
+		return inputs_count;
+	}
+
+	uint64_t getParametersCount() const
+	{
+		return neurons_count * (1 + inputs_count);
+	}
+
+	// In the network's parameters the layer's biases are followed by its weights
+	const float* getBias(const float* parameters) const
+	{
+		return parameters + parameters_offset;
+	}
+
+	// Weights of a neuron are contiguous
+	const float* getWeights(const float* parameters, const uint64_t neuron_id) const
+	{
+		return parameters + parameters_offset + neurons_count + neuron_id * inputs_count;
+	}
+
+	void process(const float* parameters, const float* inputs, float* outputs) const
+	{
+		processBatch(parameters, inputs, 1, outputs);
 	}
 
-	void process(const std::vector<float>& inputs)
+	// Same computation for batch_size contiguous inputs sharing the weights
+	void processBatch(const float* parameters, const float* inputs, const uint64_t batch_size, float* outputs) const
 	{
-		const uint64_t neurons_count = bias.size();
-		const uint64_t inputs_count = inputs.size();
-		// For each neuron
+		const float* bias = getBias(parameters);
 		for (uint64_t i(0); i < neurons_count; ++i) {
-			float result = bias[i];
-			// Compute weighted sum of inputs
-			for (uint64_t j(0); j < inputs_count; ++j) {
-				result += weights[i][j] * inputs[j];
+			const float* neuron_weights = getWeights(parameters, i);
+			for (uint64_t b(0); b < batch_size; ++b) {
+				const float* batch_inputs = inputs + b * inputs_count;
+				float result = bias[i];
+				// Compute weighted sum of inputs
+				for (uint64_t j(0); j < inputs_count; ++j) {
+					result += neuron_weights[j] * batch_inputs[j];
+				}
+				outputs[b * neurons_count + i] = tanh(result);
 			}
-			// Output result
-			values[i] = tanh(result);
 		}
 	}
 
-	void print() const
+	void print(const float* parameters) const
 	{
 		std::cout << "--- layer ---" << std::endl;
-		const uint64_t neurons_count = values.size();
+		const float* bias = getBias(parameters);
 		for (uint64_t i(0); i < neurons_count; ++i) {
-			const uint64_t inputs_count = getWeightsCount();
-			// Compute weighted sum of inputs
+			const float* neuron_weights = getWeights(parameters, i);
 			std::cout << "Neuron " << i << " bias " << bias[i] << std::endl;
 			for (uint64_t j(0); j < inputs_count; ++j) {
-				std::cout << weights[i][j] << " ";
+				std::cout << neuron_weights[j] << " ";
 			}
 			std::cout << std::endl;
 		}
 		std::cout << "--- end ---\n" << std::endl;
 	}
 
-	std::vector<std::vector<float>> weights;
-	std::vector<float> values;
-	std::vector<float> bias;
+	uint64_t inputs_count;
+	uint64_t neurons_count;
+	// Position of the layer in the network's parameters
+	uint64_t parameters_offset;
+	// Position of the layer's values in a network state
+	uint64_t values_offset;
+};
+
+
+/*
+	Shape of the networks of an architecture, shared by all of them so that a network
+	is only two pointers: its layout and its parameters.
+	A state is the input followed by every layer's values, networks don't keep one.
+*/
+struct NetworkLayout
+{
+	NetworkLayout(const std::vector<uint64_t>& layers_sizes_)
+		: layers_sizes(layers_sizes_)
+		, input_size(layers_sizes_[0])
+		, parameters_count(0)
+		, state_size(input_size)
+		, max_neurons_count(0)
+	{
+		for (uint64_t i(1); i < layers_sizes.size(); ++i) {
+			const uint64_t neurons_count = layers_sizes[i];
+			layers.emplace_back(neurons_count, layers_sizes[i - 1], parameters_count, state_size);
+			parameters_count += layers.back().getParametersCount();
+			state_size += neurons_count;
+			max_neurons_count = std::max(max_neurons_count, neurons_count);
+		}
+	}
+
+	// Layouts are never freed, networks can keep a pointer to theirs
+	static const NetworkLayout& get(const std::vector<uint64_t>& layers_sizes)
+	{
+		static std::mutex mutex;
+		// Elements of a deque don't move when it grows
+		static std::deque<NetworkLayout> layouts;
+		std::lock_guard<std::mutex> lg(mutex);
+		for (const NetworkLayout& layout : layouts) {
+			if (layout.layers_sizes == layers_sizes) {
+				return layout;
+			}
+		}
+		layouts.emplace_back(layers_sizes);
+		return layouts.back();
+	}
+
+	std::vector<uint64_t> layers_sizes;
+	uint64_t input_size;
+	std::vector<Layer> layers;
+	uint64_t parameters_count;
+	uint64_t state_size;
+	uint64_t max_neurons_count;
 };
 
 
+/*
+	The network does not own its parameters, they are read where the genome stores them.
+	bind has to be called again if they move.
+*/
 struct Network
 {
 	Network()
-		: input_size(0)
-		, last_input(0)
+		: layout(nullptr)
+		, parameters(nullptr)
 	{}
 
-	Network(const uint64_t input_size_)
-		: input_size(input_size_)
-		, last_input(input_size_)
+	Network(const std::vector<uint64_t>& layers_sizes)
+		: layout(&NetworkLayout::get(layers_sizes))
+		, parameters(nullptr)
 	{}
 
-	Network(const std::vector<uint64_t>& layers_sizes)
-		: input_size(layers_sizes[0])
-		, last_input(input_size)
+	// Parameters in the DNA order: for each layer its biases then its weights
+	void bind(const float* parameters_)
 	{
-		for (uint64_t i(1); i < layers_sizes.size(); ++i) {
-			addLayer(layers_sizes[i]);
-		}
+		parameters = parameters_;
 	}
 
-	void addLayer(const uint64_t neurons_count)
+	const std::vector<Layer>& getLayers() const
 	{
-		if (!layers.empty()) {
-			layers.emplace_back(neurons_count, layers.back().getNeuronsCount());
-		}
-		else {
-			layers.emplace_back(neurons_count, input_size);
+		return layout->layers;
+	}
+
+	uint64_t getInputSize() const
+	{
+		return layout ? layout->input_size : 0;
+	}
+
+	uint64_t getStateSize() const
+	{
+		return layout ? layout->state_size : 0;
+	}
+
+	const float* getValues(const float* state, const uint64_t layer_id) const
+	{
+		return state + layout->layers[layer_id].values_offset;
+	}
+
+	const float* getWeights(const uint64_t layer_id, const uint64_t neuron_id) const
+	{
+		return layout->layers[layer_id].getWeights(parameters, neuron_id);
+	}
+
+	// The state starts with the input, the layers' values are written after it. Returns the outputs
+	const float* execute(float* state) const
+	{
+		const std::vector<Layer>& layers = layout->layers;
+		const uint64_t layers_count = layers.size();
+		const float* layer_inputs = state;
+		for (uint64_t i(0); i < layers_count; ++i) {
+			float* layer_outputs = state + layers[i].values_offset;
+			layers[i].process(parameters, layer_inputs, layer_outputs);
+			layer_inputs = layer_outputs;
 		}
+		return layer_inputs;
 	}
 
-	const std::vector<float>& execute(const std::vector<float>& input)
+	// Executes the network on batch_size inputs, outputs are written contiguously.
+	// Intermediate values go to scratch so that they don't have to be stored in each network
+	void executeBatch(const float* inputs, const uint64_t batch_size, float* outputs, std::vector<float>& scratch) const
 	{
-		last_input = input;
-		if (input.size() == input_size) {
-			layers.front().process(input);
-			const uint64_t layers_count = layers.size();
-			for (uint64_t i(1); i < layers_count; ++i) {
-				layers[i].process(layers[i - 1].values);
-			}
+		if (!batch_size) {
+			return;
+		}
+
+		// Two halves used alternately as layers inputs and outputs
+		const uint64_t half_size = layout->max_neurons_count * batch_size;
+		if (scratch.size() < 2 * half_size) {
+			scratch.resize(2 * half_size);
+		}
+
+		const std::vector<Layer>& layers = layout->layers;
+		const float* layer_inputs = inputs;
+		const uint64_t layers_count = layers.size();
+		for (uint64_t i(0); i < layers_count; ++i) {
+			float* layer_outputs = (i + 1 == layers_count) ? outputs : &scratch[(i % 2) * half_size];
+			layers[i].processBatch(parameters, layer_inputs, batch_size, layer_outputs);
+			layer_inputs = layer_outputs;
 		}
+	}
 
-		return layers.back().values;
+	uint64_t getOutputSize() const
+	{
+		return layout->layers.back().getNeuronsCount();
 	}
 
 	uint64_t getParametersCount() const
 	{
-		uint64_t result = 0;
-		for (const Layer& layer : layers) {
-			result += layer.bias.size() * (1 + layer.weights.front().size());
-		}
-		return result;
+		return layout ? layout->parameters_count : 0;
 	}
 
 	static uint64_t getParametersCount(const std::vector<uint64_t>& layers_sizes)
@@ -127,7 +243,6 @@ struct Network
 		return count;
 	}
 
-	uint64_t input_size;
-	std::vector<Layer> layers;
-	std::vector<float> last_input;
+	const NetworkLayout* layout;
+	const float* parameters;
 };
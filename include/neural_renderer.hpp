@@ -12,69 +12,124 @@ struct GLayer
 
 struct NeuralRenderer
 {
-	void render(sf::RenderTarget& target, Network& network, sf::RenderStates states)
+	// state holds the network's input and values, see Network::execute
+	void render(sf::RenderTarget& target, const Network& network, const float* state, sf::RenderStates states)
 	{
-		updateLayers(network);
+		if (!isLayoutValid(network)) {
+			updateLayers(network);
+			updateGeometry();
+		}
+		updateColors(network, state);
+
+		target.draw(links, states);
+		target.draw(neurons, states);
+	}
 
+	// Only colors change from one frame to the next
+	void updateColors(const Network& network, const float* state)
+	{
 		const uint64_t layers_count = layers.size();
-		for (uint64_t i(1); i <layers_count; ++i) {
-			const GLayer& curr_layer = layers[i];
-			const GLayer& prev_layer = layers[i - 1];
-			uint32_t neuron_id = 0;
-			for (const sf::Vector2f& neuron_pos : curr_layer.neurons_positions) {
-				uint32_t weight_id = 0;
-				for (const sf::Vector2f& prev_neuron_pos : prev_layer.neurons_positions) {
-					const float link_weight = network.layers[i - 1].weights[neuron_id][weight_id];
-					const float link_value = link_weight * (i == 1 ? network.last_input : network.layers[i - 2].values)[weight_id];
+		uint64_t link_vertex = 0;
+		for (uint64_t i(1); i < layers_count; ++i) {
+			const float* prev_values = (i == 1 ? state : network.getValues(state, i - 2));
+			const uint64_t neurons_count = layers[i].neurons_positions.size();
+			const uint64_t prev_neurons_count = layers[i - 1].neurons_positions.size();
+			for (uint64_t neuron_id(0); neuron_id < neurons_count; ++neuron_id) {
+				const float* weights = network.getWeights(i - 1, neuron_id);
+				for (uint64_t weight_id(0); weight_id < prev_neurons_count; ++weight_id) {
+					const float link_value = weights[weight_id] * prev_values[weight_id];
 					const float color_value = std::pow(link_value + 1.0f, 3.0f);
-					const sf::Vector3f link_color = sf::Vector3f(128, 128, 128) + sf::Vector3f(color_value, color_value, color_value);
-					const float link_width = 2.0f;// 2.0f * log2(1.0f + std::abs(link_value));
-					target.draw(getLine(neuron_pos, prev_neuron_pos, link_width, toColor(link_color)), states);
-					++weight_id;
+					const sf::Color link_color = toColor(sf::Vector3f(128, 128, 128) + sf::Vector3f(color_value, color_value, color_value));
+					for (uint32_t k(0); k < 4; ++k) {
+						links[link_vertex++].color = link_color;
+					}
 				}
-				++neuron_id;
 			}
 		}
 
-		uint32_t layer_id = 0;
-		for (GLayer& layer : layers) {
-			uint32_t neuron_id = 0;
-			for (const sf::Vector2f& pos : layer.neurons_positions) {
-				const sf::Vector3f base_color(120, 120, 120);
-				const sf::Vector3f activated_color(255, 255, 255);
-				
-				sf::Color neuron_color;
-				float current_neuron_radius = neuron_radius;
+		const sf::Vector3f base_color(120, 120, 120);
+		const sf::Vector3f activated_color(255, 255, 255);
+		const uint64_t disk_vertices = 3 * circle_quality;
+		uint64_t neuron_index = 0;
+		for (uint64_t layer_id(0); layer_id < layers_count; ++layer_id) {
+			const uint64_t neurons_count = layers[layer_id].neurons_positions.size();
+			for (uint64_t neuron_id(0); neuron_id < neurons_count; ++neuron_id) {
 				float intensity = 0.0f;
-
 				if (!layer_id) {
-					intensity = std::min(1.0f, std::abs(network.last_input[neuron_id]));
-				}
-				else if (layer_id == layers_count - 1) {
-					intensity = std::abs(network.layers.back().values[neuron_id]);
+					intensity = std::min(1.0f, std::abs(state[neuron_id]));
 				}
 				else {
-					intensity = std::abs(network.layers[layer_id-1].values[neuron_id]);
-					current_neuron_radius = neuron_radius * 0.8f;
+					intensity = std::abs(network.getValues(state, layer_id - 1)[neuron_id]);
 				}
 
-				sf::Vector3f color_vec = intensity * activated_color + std::pow(1.0f - intensity, 3.0f) * base_color;
-				neuron_color = toColor(color_vec);
-
-				sf::CircleShape neuron_shape(current_neuron_radius);
-				neuron_shape.setOrigin(current_neuron_radius, current_neuron_radius);
-				neuron_shape.setPosition(pos);
-				neuron_shape.setFillColor(sf::Color::Black);
-				neuron_shape.setOutlineColor(sf::Color::White);
-				neuron_shape.setOutlineThickness(1.0f);
-				target.draw(neuron_shape, states);
-				neuron_shape.setFillColor(neuron_color);
-				neuron_shape.setScale(0.9f, 0.9f);
-				neuron_shape.setOutlineThickness(0.0f);
-				target.draw(neuron_shape, states);
-				++neuron_id;
+				const sf::Color neuron_color = toColor(intensity * activated_color + std::pow(1.0f - intensity, 3.0f) * base_color);
+				// Each neuron is an outline, a black disk and the colored disk
+				const uint64_t first = (3 * neuron_index + 2) * disk_vertices;
+				for (uint64_t v(first); v < first + disk_vertices; ++v) {
+					neurons[v].color = neuron_color;
+				}
+				++neuron_index;
 			}
-			++layer_id;
+		}
+	}
+
+	bool isLayoutValid(const Network& network) const
+	{
+		const std::vector<Layer>& network_layers = network.getLayers();
+		if (layout_position != position || layers.size() != network_layers.size() + 1) {
+			return false;
+		}
+		if (layers.front().neurons_positions.size() != network.getInputSize()) {
+			return false;
+		}
+		for (uint64_t i(0); i < network_layers.size(); ++i) {
+			if (layers[i + 1].neurons_positions.size() != network_layers[i].getNeuronsCount()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void updateGeometry()
+	{
+		links.setPrimitiveType(sf::Quads);
+		links.clear();
+		const float link_width = 2.0f;
+		for (uint64_t i(1); i < layers.size(); ++i) {
+			for (const sf::Vector2f& neuron_pos : layers[i].neurons_positions) {
+				for (const sf::Vector2f& prev_neuron_pos : layers[i - 1].neurons_positions) {
+					const sf::Vector2f v = prev_neuron_pos - neuron_pos;
+					const sf::Vector2f normal = (0.5f * link_width / getLength(v)) * sf::Vector2f(-v.y, v.x);
+					links.append(sf::Vertex(neuron_pos + normal));
+					links.append(sf::Vertex(prev_neuron_pos + normal));
+					links.append(sf::Vertex(prev_neuron_pos - normal));
+					links.append(sf::Vertex(neuron_pos - normal));
+				}
+			}
+		}
+
+		neurons.setPrimitiveType(sf::Triangles);
+		neurons.clear();
+		const uint64_t layers_count = layers.size();
+		for (uint64_t layer_id(0); layer_id < layers_count; ++layer_id) {
+			const bool hidden = layer_id && layer_id < layers_count - 1;
+			const float radius = hidden ? neuron_radius * 0.8f : neuron_radius;
+			for (const sf::Vector2f& pos : layers[layer_id].neurons_positions) {
+				addDisk(pos, radius + 1.0f, sf::Color::White);
+				addDisk(pos, radius, sf::Color::Black);
+				addDisk(pos, radius * 0.9f, sf::Color::Black);
+			}
+		}
+		layout_position = position;
+	}
+
+	void addDisk(sf::Vector2f center, float radius, sf::Color color)
+	{
+		const float da = 2.0f * PI / float(circle_quality);
+		for (uint32_t i(0); i < circle_quality; ++i) {
+			neurons.append(sf::Vertex(center, color));
+			neurons.append(sf::Vertex(center + radius * sf::Vector2f(cos(i * da), sin(i * da)), color));
+			neurons.append(sf::Vertex(center + radius * sf::Vector2f(cos((i + 1) * da), sin((i + 1) * da)), color));
 		}
 	}
 
@@ -93,12 +148,12 @@ struct NeuralRenderer
 		return sf::Vector2f(getWidth(layers_count), getLayerHeight(max_neurons_on_layer));
 	}
 
-	void updateLayers(Network& network)
+	void updateLayers(const Network& network)
 	{
 		layers.clear();
 		// Find network height
-		float max_layer_height = getLayerHeight(network.input_size);
-		for (const Layer& layer : network.layers) {
+		float max_layer_height = getLayerHeight(network.getInputSize());
+		for (const Layer& layer : network.getLayers()) {
 			const float layer_height = getLayerHeight(layer.getNeuronsCount());
 			if (layer_height > max_layer_height) {
 				max_layer_height = layer_height;
@@ -106,17 +161,17 @@ struct NeuralRenderer
 		}
 
 		float layer_x = position.x;
-		float layer_height = getLayerHeight(network.input_size);
+		float layer_height = getLayerHeight(network.getInputSize());
 		float neuron_y = position.y + 0.5f * (max_layer_height - layer_height) + neuron_radius;
 		// Draw inputs
 		layers.emplace_back();
-		for (uint64_t i(0); i < network.input_size; ++i) {
+		for (uint64_t i(0); i < network.getInputSize(); ++i) {
 			layers.back().neurons_positions.push_back(sf::Vector2f(layer_x, neuron_y));
 			neuron_y += 2.0f * neuron_radius + neuron_spacing;
 		}
 		layer_x += 2.0f * neuron_radius + layer_spacing;
 		// Draw layers
-		for (const Layer& layer : network.layers) {
+		for (const Layer& layer : network.getLayers()) {
 			layers.emplace_back();
 			layer_height = getLayerHeight(layer.getNeuronsCount());
 			neuron_y = position.y + 0.5f * (max_layer_height - layer_height) + neuron_radius;
@@ -134,4 +189,10 @@ struct NeuralRenderer
 	float layer_spacing = 60.0f;
 	sf::Vector2f position;
 	std::vector<GLayer> layers;
+
+	// Geometry is only rebuilt when the architecture or the position change
+	static constexpr uint32_t circle_quality = 30;
+	sf::Vector2f layout_position;
+	sf::VertexArray links;
+	sf::VertexArray neurons;
 };
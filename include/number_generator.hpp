@@ -46,9 +46,9 @@ struct NumberGenerator
 		return *s_instance;
 	}
 
-	static void initialize()
+	static void initialize(bool random_seed = true)
 	{
-		s_instance = std::make_unique<NumberGenerator>(true);
+		s_instance = std::make_unique<NumberGenerator>(random_seed);
 	}
 
 	std::uniform_real_distribution<float> distribution;
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include "dna.hpp"
+
+
+/*
+	Search strategy over genomes, driven by ask and tell:
+	the genomes given by ask are evaluated then their results are given back to tell.
+	The first tell receives the initial random population.
+*/
+struct Optimizer
+{
+	virtual ~Optimizer() = default;
+
+	virtual const char* getName() const = 0;
+
+	// Results of the genomes just evaluated, a higher fitness is better
+	virtual void tell(const std::vector<DNA>& genomes, const std::vector<float>& fitness) = 0;
+
+	// Writes the next genomes to evaluate, genomes already has the population's size
+	virtual void ask(std::vector<DNA>& genomes) = 0;
+
+	// DNA stores the network's parameters as floats
+	static uint64_t getParametersCount(const DNA& dna)
+	{
+		return dna.getElementsCount<float>();
+	}
+
+	static void read(const DNA& dna, float* parameters)
+	{
+		std::memcpy(parameters, dna.getBytes(), dna.getBytesCount());
+	}
+
+	static void write(const float* parameters, DNA& dna)
+	{
+		std::memcpy(dna.getBytes(), parameters, dna.getBytesCount());
+	}
+
+	// Indexes of the genomes from the best to the worst
+	static void sortIndexes(const std::vector<float>& fitness, std::vector<uint32_t>& indexes)
+	{
+		indexes.resize(fitness.size());
+		std::iota(indexes.begin(), indexes.end(), 0);
+		std::stable_sort(indexes.begin(), indexes.end(), [&](uint32_t a, uint32_t b) {return fitness[a] > fitness[b]; });
+	}
+};
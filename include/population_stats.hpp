@@ -0,0 +1,226 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include "stadium.hpp"
+
+
+/*
+	Summary of an evaluated generation, computed by the stadium's workers: each one gathers
+	and sorts its slice of the population, the sorted slices are then merged to read percentiles.
+	Diversity is the mean distance between random pairs of genomes, divided by the square root
+	of the parameters count so that it reads as a typical difference of one parameter.
+	Cached and remote results carry their flight time and targets, every rocket is counted.
+*/
+struct PopulationStats
+{
+	struct Summary
+	{
+		uint32_t generation = 0;
+		// Genomes fitness, mean over their scenarios
+		float fitness_mean = 0.0f;
+		float fitness_min = 0.0f;
+		float fitness_p10 = 0.0f;
+		float fitness_p25 = 0.0f;
+		float fitness_median = 0.0f;
+		float fitness_p75 = 0.0f;
+		float fitness_p90 = 0.0f;
+		float fitness_max = 0.0f;
+		// Flight time of every rocket
+		float survival_mean = 0.0f;
+		float survival_p10 = 0.0f;
+		float survival_median = 0.0f;
+		float survival_p90 = 0.0f;
+		float targets_mean = 0.0f;
+		uint32_t targets_max = 0;
+		float diversity = 0.0f;
+	};
+
+	// Sums of one worker
+	struct alignas(64) Partial
+	{
+		double fitness_sum;
+		double survival_sum;
+		uint64_t targets_sum;
+		uint32_t targets_max;
+		double distance_sum;
+	};
+
+	uint32_t diversity_samples;
+	Summary last;
+	std::vector<float> fitness;
+	std::vector<float> survival;
+	std::vector<Partial> partials;
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	// Its own generator so that sampling does not change the evolution's random sequence
+	std::mt19937 generator;
+	std::ofstream csv;
+
+	PopulationStats(uint32_t diversity_samples_ = 512)
+		: diversity_samples(diversity_samples_)
+		, generator(0)
+	{}
+
+	void setCsvOutput(const std::string& filename)
+	{
+		csv.open(filename, std::ios::out | std::ios::trunc);
+		csv << "generation,fitness_mean,fitness_min,fitness_p10,fitness_p25,fitness_median,fitness_p75,fitness_p90,fitness_max,"
+			<< "survival_mean,survival_p10,survival_median,survival_p90,targets_mean,targets_max,diversity" << std::endl;
+	}
+
+	// To call once the generation is evaluated and before Stadium::nextIteration
+	const Summary& compute(Stadium& stadium, uint32_t generation)
+	{
+		const uint32_t population_size = stadium.population_size;
+		const uint32_t scenarios_count = stadium.scenarios_count;
+		const uint32_t threads_count = stadium.swarm.getThreadCount();
+		fitness.resize(population_size);
+		survival.resize(uint64_t(population_size) * scenarios_count);
+		partials.resize(threads_count);
+		drawPairs(population_size);
+
+		auto group = stadium.swarm.execute([&](uint32_t thread_id, uint32_t max_thread) {
+			Partial& partial = partials[thread_id];
+			partial = { 0.0, 0.0, 0, 0, 0.0 };
+			const uint64_t begin = getSliceBegin(population_size, thread_id, max_thread);
+			const uint64_t end = getSliceBegin(population_size, thread_id + 1, max_thread);
+			for (uint64_t i(begin); i < end; ++i) {
+				fitness[i] = stadium.getFitness(i);
+				partial.fitness_sum += fitness[i];
+				for (uint32_t k(0); k < scenarios_count; ++k) {
+					const float time = stadium.getBody(i, k).time;
+					const uint32_t targets = stadium.getObjective(i, k).target_id;
+					survival[i * scenarios_count + k] = time;
+					partial.survival_sum += time;
+					partial.targets_sum += targets;
+					partial.targets_max = std::max(partial.targets_max, targets);
+				}
+			}
+			std::sort(fitness.begin() + begin, fitness.begin() + end);
+			std::sort(survival.begin() + begin * scenarios_count, survival.begin() + end * scenarios_count);
+
+			const uint64_t pairs_begin = getSliceBegin(pairs.size(), thread_id, max_thread);
+			const uint64_t pairs_end = getSliceBegin(pairs.size(), thread_id + 1, max_thread);
+			const std::vector<Rocket>& rockets = stadium.selector.getCurrentPopulation();
+			for (uint64_t p(pairs_begin); p < pairs_end; ++p) {
+				partial.distance_sum += std::sqrt(getSquaredDistance(rockets[pairs[p].first].network, rockets[pairs[p].second].network));
+			}
+		});
+		group.waitExecutionDone();
+
+		mergeSlices(fitness, population_size, 1, threads_count);
+		mergeSlices(survival, population_size, scenarios_count, threads_count);
+
+		Summary& s = last;
+		s = Summary();
+		s.generation = generation;
+		uint64_t targets_sum = 0;
+		double distance_sum = 0.0;
+		for (const Partial& partial : partials) {
+			s.fitness_mean += static_cast<float>(partial.fitness_sum);
+			s.survival_mean += static_cast<float>(partial.survival_sum);
+			targets_sum += partial.targets_sum;
+			s.targets_max = std::max(s.targets_max, partial.targets_max);
+			distance_sum += partial.distance_sum;
+		}
+		s.fitness_mean /= float(population_size);
+		s.survival_mean /= float(survival.size());
+		s.targets_mean = float(targets_sum) / float(survival.size());
+		s.fitness_min = fitness.front();
+		s.fitness_p10 = getPercentile(fitness, 0.10f);
+		s.fitness_p25 = getPercentile(fitness, 0.25f);
+		s.fitness_median = getPercentile(fitness, 0.50f);
+		s.fitness_p75 = getPercentile(fitness, 0.75f);
+		s.fitness_p90 = getPercentile(fitness, 0.90f);
+		s.fitness_max = fitness.back();
+		s.survival_p10 = getPercentile(survival, 0.10f);
+		s.survival_median = getPercentile(survival, 0.50f);
+		s.survival_p90 = getPercentile(survival, 0.90f);
+		if (!pairs.empty()) {
+			const uint64_t parameters_count = stadium.selector.getCurrentPopulation()[0].network.getParametersCount();
+			s.diversity = static_cast<float>(distance_sum / double(pairs.size()) / std::sqrt(double(parameters_count)));
+		}
+
+		if (csv.is_open()) {
+			csv << s.generation << "," << s.fitness_mean << "," << s.fitness_min << "," << s.fitness_p10 << "," << s.fitness_p25 << ","
+				<< s.fitness_median << "," << s.fitness_p75 << "," << s.fitness_p90 << "," << s.fitness_max << ","
+				<< s.survival_mean << "," << s.survival_p10 << "," << s.survival_median << "," << s.survival_p90 << ","
+				<< s.targets_mean << "," << s.targets_max << "," << s.diversity << std::endl;
+		}
+		return last;
+	}
+
+	static uint64_t getSliceBegin(uint64_t count, uint32_t slice, uint32_t slices_count)
+	{
+		return count * slice / slices_count;
+	}
+
+	void drawPairs(uint32_t population_size)
+	{
+		pairs.clear();
+		if (population_size < 2) {
+			return;
+		}
+		const uint64_t all_pairs = uint64_t(population_size) * (population_size - 1) / 2;
+		const uint64_t count = std::min(uint64_t(diversity_samples), all_pairs);
+		std::uniform_int_distribution<uint32_t> distribution(0, population_size - 1);
+		for (uint64_t p(0); p < count; ++p) {
+			const uint32_t a = distribution(generator);
+			uint32_t b = distribution(generator);
+			while (b == a) {
+				b = distribution(generator);
+			}
+			pairs.emplace_back(a, b);
+		}
+	}
+
+	// Independent accumulators so that the compiler can keep several vector lanes busy
+	static float getSquaredDistance(const float* a, const float* b, uint64_t count)
+	{
+		float sums[8] = {};
+		uint64_t i(0);
+		for (; i + 8 <= count; i += 8) {
+			for (uint32_t k(0); k < 8; ++k) {
+				const float d = a[i + k] - b[i + k];
+				sums[k] += d * d;
+			}
+		}
+		float result = 0.0f;
+		for (; i < count; ++i) {
+			const float d = a[i] - b[i];
+			result += d * d;
+		}
+		for (const float sum : sums) {
+			result += sum;
+		}
+		return result;
+	}
+
+	// Over the genome's parameters, that are also the network's
+	static float getSquaredDistance(const Network& a, const Network& b)
+	{
+		return getSquaredDistance(a.parameters, b.parameters, a.getParametersCount());
+	}
+
+	// Each slice is sorted, merges them pairwise
+	static void mergeSlices(std::vector<float>& values, uint64_t count, uint32_t stride, uint32_t slices_count)
+	{
+		for (uint32_t width(1); width < slices_count; width *= 2) {
+			for (uint32_t first(0); first + width < slices_count; first += 2 * width) {
+				const uint64_t begin = getSliceBegin(count, first, slices_count) * stride;
+				const uint64_t middle = getSliceBegin(count, first + width, slices_count) * stride;
+				const uint64_t end = getSliceBegin(count, std::min(first + 2 * width, slices_count), slices_count) * stride;
+				std::inplace_merge(values.begin() + begin, values.begin() + middle, values.begin() + end);
+			}
+		}
+	}
+
+	static float getPercentile(const std::vector<float>& sorted, float ratio)
+	{
+		const uint64_t index = static_cast<uint64_t>(ratio * float(sorted.size() - 1) + 0.5f);
+		return sorted[index];
+	}
+};
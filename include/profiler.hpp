@@ -0,0 +1,208 @@
+#pragma once
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <array>
+#include <string>
+#include <fstream>
+
+
+/*
+	Hot path timers aggregated per generation. Each thread accumulates in its own lane
+	so timing never synchronizes the workers, a disabled profiler only costs a branch.
+	Lane 0 is the main thread, worker i uses lane i + 1. Lanes can be read while
+	their thread is still running, a lap may then be accounted to the next generation.
+*/
+struct Profiler
+{
+	enum Phase
+	{
+		Update,
+		Dispatch,
+		Inputs,
+		Inference,
+		Physics,
+		Smoke,
+		Fitness,
+		Breeding,
+		DnaIO,
+		Events,
+		Publish,
+		RenderRockets,
+		RenderTargets,
+		RenderNetwork,
+		RenderFitness,
+		Display,
+		PhasesCount
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	struct alignas(64) Lane
+	{
+		std::array<std::atomic<int64_t>, PhasesCount> nanoseconds;
+
+		Lane()
+		{
+			for (std::atomic<int64_t>& n : nanoseconds) {
+				n.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		Lane(const Lane& other)
+		{
+			for (uint32_t i(0); i < PhasesCount; ++i) {
+				nanoseconds[i].store(other.nanoseconds[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+		}
+	};
+
+	// Milliseconds spent in each phase during a generation
+	struct Row
+	{
+		uint32_t generation = 0;
+		uint32_t steps = 0;
+		std::array<double, PhasesCount> milliseconds{};
+	};
+
+	// Accumulates the time between consecutive laps in the given phases
+	struct Timer
+	{
+		Profiler& profiler;
+		uint32_t lane;
+		// False if the profiler was disabled when last was due, last is then meaningless
+		bool started;
+		Clock::time_point last;
+
+		Timer(uint32_t lane_ = 0)
+			: profiler(Profiler::getInstance())
+			, lane(lane_)
+			, started(profiler.enabled)
+		{
+			if (started) {
+				last = Clock::now();
+			}
+		}
+
+		int64_t lap(Phase phase)
+		{
+			if (!profiler.enabled) {
+				started = false;
+				return 0;
+			}
+			const Clock::time_point now = Clock::now();
+			// Enabled since the last lap, the elapsed time is unknown
+			if (!started) {
+				started = true;
+				last = now;
+				return 0;
+			}
+			const int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+			profiler.add(phase, lane, elapsed);
+			last = now;
+			return elapsed;
+		}
+
+		// Restarts without accounting the elapsed time
+		void skip()
+		{
+			started = profiler.enabled;
+			if (started) {
+				last = Clock::now();
+			}
+		}
+	};
+
+	struct Scope
+	{
+		Timer timer;
+		Phase phase;
+
+		Scope(Phase phase_, uint32_t lane = 0)
+			: timer(lane)
+			, phase(phase_)
+		{}
+
+		~Scope()
+		{
+			timer.lap(phase);
+		}
+	};
+
+	// Switched by the main thread, read by all the timers
+	std::atomic<bool> enabled{ false };
+	std::vector<Lane> lanes;
+	Row last_row;
+	std::ofstream csv;
+
+	Profiler()
+		: lanes(1)
+	{}
+
+	static Profiler& getInstance()
+	{
+		static Profiler instance;
+		return instance;
+	}
+
+	static const char* getPhaseName(uint32_t phase)
+	{
+		static const char* names[PhasesCount] = {
+			"update", "dispatch", "inputs", "inference", "physics", "smoke", "fitness",
+			"breeding", "dna_io", "events", "publish", "render_rockets", "render_targets",
+			"render_network", "render_fitness", "display"
+		};
+		return names[phase];
+	}
+
+	// Has to be called while no timer is running
+	void setThreadCount(uint32_t thread_count)
+	{
+		if (lanes.size() < thread_count + 1) {
+			lanes.resize(thread_count + 1);
+		}
+	}
+
+	void add(Phase phase, uint32_t lane, int64_t nanoseconds)
+	{
+		// Atomic increment, endGeneration may be resetting the lane from another thread
+		lanes[lane].nanoseconds[phase].fetch_add(nanoseconds, std::memory_order_relaxed);
+	}
+
+	void setCsvOutput(const std::string& filename)
+	{
+		csv.open(filename, std::ios::out | std::ios::trunc);
+		csv << "generation,steps";
+		for (uint32_t i(0); i < PhasesCount; ++i) {
+			csv << "," << getPhaseName(i) << "_ms";
+		}
+		csv << std::endl;
+	}
+
+	// Worker phases are summed over threads, so they are CPU time and not wall time
+	const Row& endGeneration(uint32_t generation, uint32_t steps)
+	{
+		if (!enabled) {
+			return last_row;
+		}
+
+		last_row.generation = generation;
+		last_row.steps = steps;
+		last_row.milliseconds.fill(0.0);
+		for (Lane& lane : lanes) {
+			for (uint32_t i(0); i < PhasesCount; ++i) {
+				last_row.milliseconds[i] += lane.nanoseconds[i].exchange(0, std::memory_order_relaxed) * 1e-6;
+			}
+		}
+
+		if (csv.is_open()) {
+			csv << generation << "," << steps;
+			for (const double ms : last_row.milliseconds) {
+				csv << "," << ms;
+			}
+			csv << std::endl;
+		}
+
+		return last_row;
+	}
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "stadium.hpp"
+
+
+/*
+	Re-simulates a single rocket from its genome and scenario seed using the exact
+	same step functions as the Stadium, then exposes the flight as a timeline
+*/
+struct Replay
+{
+	struct Frame
+	{
+		sf::Vector2f position;
+		float angle;
+		float thruster_power;
+		float thruster_angle;
+		float avg_power;
+		float avg_angle;
+		float fitness;
+		float time_in;
+		uint32_t target_id;
+		bool alive;
+	};
+
+	Scenario scenario;
+	Rocket rocket;
+	Objective objective;
+	float dt;
+	std::vector<Frame> frames;
+
+	Replay()
+		: dt(0.0f)
+	{}
+
+	void load(const Stadium& stadium, const DNA& dna, uint32_t scenario_seed, float dt_, float max_time = 90.0f)
+	{
+		dt = dt_;
+		scenario.generate(scenario_seed, stadium.area_size, stadium.targets_count, stadium.physics_variation);
+		rocket.loadDNA(dna);
+		simulate(stadium, max_time);
+	}
+
+	void simulate(const Stadium& stadium, float max_time)
+	{
+		stadium.initializeBody(rocket, objective, scenario);
+		frames.clear();
+		record();
+
+		std::vector<float> inputs(rocket.network.getInputSize());
+		std::vector<float> outputs(rocket.network.getOutputSize());
+		std::vector<float> scratch;
+		float time = 0.0f;
+		while (rocket.alive && time < max_time) {
+			float to_target_dist;
+			const bool use_network = stadium.prepareStep(rocket, objective, scenario, dt, inputs.data(), to_target_dist);
+			if (use_network) {
+				rocket.network.executeBatch(inputs.data(), 1, outputs.data(), scratch);
+			}
+			stadium.finishStep(rocket, objective, scenario, use_network ? outputs.data() : nullptr, to_target_dist, dt);
+			time += dt;
+			record();
+		}
+	}
+
+	void record()
+	{
+		Frame frame;
+		frame.position = rocket.position;
+		frame.angle = rocket.getAngle();
+		frame.thruster_power = rocket.thruster.power;
+		frame.thruster_angle = rocket.thruster.angle;
+		frame.avg_power = rocket.thruster.getAvgPowerRatio();
+		frame.avg_angle = rocket.thruster.getAvgAngle();
+		frame.fitness = rocket.fitness;
+		frame.time_in = objective.time_in;
+		frame.target_id = objective.target_id;
+		frame.alive = rocket.alive;
+		frames.push_back(frame);
+	}
+
+	bool empty() const
+	{
+		return frames.empty();
+	}
+
+	float getDuration() const
+	{
+		return frames.empty() ? 0.0f : (frames.size() - 1) * dt;
+	}
+
+	uint64_t getFrameIndex(float time) const
+	{
+		const int64_t index = static_cast<int64_t>(time / dt);
+		return as<uint64_t>(clamp(int64_t(0), int64_t(frames.size()) - 1, index));
+	}
+
+	// Loads the state at the given time in rocket and objective so they can be rendered
+	const Frame& seek(float time)
+	{
+		const Frame& frame = frames[getFrameIndex(time)];
+		rocket.position = frame.position;
+		rocket.setAngle(frame.angle);
+		rocket.thruster.power = frame.thruster_power;
+		rocket.thruster.angle = frame.thruster_angle;
+		rocket.thruster.direction = sf::Vector2f(cos(frame.thruster_angle), sin(frame.thruster_angle));
+		rocket.thruster.avg_power.set(frame.avg_power);
+		rocket.thruster.avg_angle.set(frame.avg_angle);
+		rocket.fitness = frame.fitness;
+		rocket.alive = frame.alive;
+		objective.time_in = frame.time_in;
+		objective.target_id = frame.target_id;
+		return frame;
+	}
+};
@@ -1,8 +1,8 @@
 #pragma once
 #include "ai_unit.hpp"
 #include "smoke.hpp"
-#include <list>
 #include "moving_average.hpp"
+#include "rotation.hpp"
 
 
 std::vector<uint64_t> architecture{ 7, 9, 9, 2 };
@@ -11,28 +11,35 @@ struct Rocket : AiUnit
 {
 	struct Thruster
 	{
+		static constexpr float nominal_power = 3000.0f;
+
 		float max_angle;
 		float angle;
 		float target_angle;
+		// (cos, sin) of angle, only maintained with rotation vectors
+		sf::Vector2f direction;
 
 		float max_power;
 		float power;
 
-		MovingAverage avg_power;
-		MovingAverage avg_angle;
+		ExponentialAverage avg_power;
+		ExponentialAverage avg_angle;
 
 		Thruster()
-			: max_power(3000.0f)
+			: max_power(nominal_power)
 			, max_angle(HalfPI)
 			, avg_power(60)
 			, avg_angle(60)
 		{}
 
-		void update(float dt)
+		// Returns the rotation applied during this step
+		float update(float dt)
 		{
 			const float angle_speed = 1.0f;
-			angle += angle_speed * dt * (target_angle - angle);
+			const float rotation = angle_speed * dt * (target_angle - angle);
+			angle += rotation;
 			avg_angle.addValue(angle);
+			return rotation;
 		}
 
 		float getNormAngle() const
@@ -71,26 +78,47 @@ struct Rocket : AiUnit
 			power = 0.0f;
 			angle = 0.0f;
 			target_angle = 0.0f;
+			direction = sf::Vector2f(1.0f, 0.0f);
 		}
 	};
 
 	Thruster thruster;
 	sf::Vector2f position;
 	sf::Vector2f velocity;
+	// Only maintained without rotation vectors, use getAngle()
 	float angle;
+	// (cos, sin) of the angle, only maintained with rotation vectors
+	sf::Vector2f direction;
 	float angular_velocity;
 	float height;
 	uint32_t index;
 	float last_power;
-	std::list<Smoke> smoke;
 	float time;
+	float gravity;
 	bool stop;
 	bool take_off;
+	// Integrates orientations as unit vectors instead of calling cos and sin every step
+	bool rotation_vectors;
+
+	// Tag used to build rockets without network, driven by another rocket's one
+	struct Replica {};
 
 	Rocket()
 		: AiUnit(architecture)
 		, height(120.0f)
 		, last_power(0.0f)
+		, gravity(1000.0f)
+		, rotation_vectors(false)
+	{
+		reset();
+	}
+
+	Rocket(Replica)
+		: AiUnit()
+		, height(120.0f)
+		, last_power(0.0f)
+		, gravity(1000.0f)
+		, rotation_vectors(false)
 	{
 		reset();
 	}
@@ -98,7 +126,7 @@ struct Rocket : AiUnit
 	void reset() 
 	{
 		velocity = sf::Vector2f(0.0f, 0.0f);
-		angle = HalfPI;
+		setAngle(HalfPI);
 		angular_velocity = 0.0f;
 		thruster.reset();
 		alive = true;
@@ -107,10 +135,47 @@ struct Rocket : AiUnit
 		stop = false;
 	}
 
-	sf::Vector2f getThrust() const
+	void setAngle(float a)
+	{
+		angle = a;
+		direction = sf::Vector2f(cos(a), sin(a));
+	}
+
+	// Computed on demand with rotation vectors
+	float getAngle() const
+	{
+		return rotation_vectors ? atan2(direction.y, direction.x) : angle;
+	}
+
+	sf::Vector2f getDirection() const
+	{
+		if (rotation_vectors) {
+			return direction;
+		}
+		return sf::Vector2f(cos(angle), sin(angle));
+	}
+
+	// Thruster direction relative to the rocket
+	sf::Vector2f getThrusterLocalDirection() const
 	{
+		if (rotation_vectors) {
+			return thruster.direction;
+		}
+		return sf::Vector2f(cos(thruster.angle), sin(thruster.angle));
+	}
+
+	sf::Vector2f getThrusterDirection() const
+	{
+		if (rotation_vectors) {
+			return Rotation::compose(direction, thruster.direction);
+		}
 		const float thruster_angle = angle + thruster.angle;
-		return -thruster.getPower() * sf::Vector2f(cos(thruster_angle), sin(thruster_angle));
+		return sf::Vector2f(cos(thruster_angle), sin(thruster_angle));
+	}
+
+	sf::Vector2f getThrust() const
+	{
+		return -thruster.getPower() * getThrusterDirection();
 	}
 
 	static float cross(sf::Vector2f v1, sf::Vector2f v2)
@@ -120,50 +185,58 @@ struct Rocket : AiUnit
 
 	float getTorque() const
 	{
-		const sf::Vector2f v(cos(thruster.angle), sin(thruster.angle));
+		const sf::Vector2f v = getThrusterLocalDirection();
 		const float inertia_coef = 0.8f;
 		return thruster.getPower() / (0.5f * height) * cross(v, sf::Vector2f(1.0f, 0.0f));
 	}
 
-	void update(float dt, bool update_smoke)
+	void update(float dt)
 	{
-		thruster.update(dt);
-		const sf::Vector2f gravity(0.0f, 1000.0f);
-		velocity += (gravity + getThrust()) * dt;
+		const float thruster_rotation = thruster.update(dt);
+		if (rotation_vectors) {
+			thruster.direction = Rotation::rotate(thruster.direction, thruster_rotation);
+		}
+		velocity += (sf::Vector2f(0.0f, gravity) + getThrust()) * dt;
 		position += velocity * dt;
 
 		angular_velocity += getTorque() * dt;
-		angle += angular_velocity * dt;
-	
-		if (update_smoke) {
-			const sf::Vector2f rocket_dir(cos(angle), sin(angle));
-			const float smoke_vert_offset = 40.0f;
-			const float smoke_duration = 0.5f;
-			const float smoke_speed_coef = 0.25f;
-			const float power_ratio = 4.0f * thruster.getAvgPowerRatio();
-			if (power_ratio > 0.15f) {
-				const float power = thruster.max_power * power_ratio;
-				const float thruster_angle = angle + thruster.angle;
-				const sf::Vector2f thruster_direction(cos(thruster_angle), sin(thruster_angle));
-				const sf::Vector2f thruster_pos = position + rocket_dir * height * 0.5f + thruster_direction * smoke_vert_offset * power_ratio;
-
-				smoke.push_back(Smoke(thruster_pos, thruster_direction, smoke_speed_coef * power, 0.15f + 0.5f * power_ratio, smoke_duration * power_ratio));
-			}
-
-			for (Smoke& s : smoke) {
-				s.update(dt);
-			}
-
-			smoke.remove_if([this](const Smoke& s) { return s.done(); });
+		if (rotation_vectors) {
+			direction = Rotation::rotate(direction, angular_velocity * dt);
+		}
+		else {
+			angle += angular_velocity * dt;
 		}
 
 		time += dt;
 	}
 
-	void process(const std::vector<float>& outputs) override
+	void emitSmoke(SmokeSystem& smoke, uint32_t lane) const
+	{
+		const sf::Vector2f rocket_dir = getDirection();
+		const float smoke_vert_offset = 40.0f;
+		const float smoke_duration = 0.5f;
+		const float smoke_speed_coef = 0.25f;
+		const float power_ratio = 4.0f * thruster.getAvgPowerRatio();
+		if (power_ratio > 0.15f) {
+			const float power = thruster.max_power * power_ratio;
+			const sf::Vector2f thruster_direction = getThrusterDirection();
+			const sf::Vector2f thruster_pos = position + rocket_dir * height * 0.5f + thruster_direction * smoke_vert_offset * power_ratio;
+
+			smoke.emit(lane, index, thruster_pos, thruster_direction, smoke_speed_coef * power, 0.15f + 0.5f * power_ratio, smoke_duration * power_ratio);
+		}
+	}
+
+	void process(const float* outputs) override
 	{
 		last_power = thruster.power;
 		thruster.setPower(0.5f * (outputs[0] + 1.0f));
 		thruster.setAngle(outputs[1]);
 	}
+
+	// Size of the rocket and of the memory it owns
+	uint64_t getBytesCount() const
+	{
+		// The network's layout is shared by all rockets
+		return sizeof(Rocket) + sizeof(float) * dna.code.capacity();
+	}
 };
@@ -1,10 +1,37 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <swarm.hpp>
 #include "rocket.hpp"
 #include "gauge_bar.hpp"
 
 
+// What the swarm view needs from a rocket, cheap to copy
+struct RocketState
+{
+	sf::Vector2f position;
+	sf::Vector2f direction;
+	sf::Vector2f thruster_direction;
+	float height;
+	float power;
+	float avg_power;
+	uint32_t index;
+	bool alive;
+
+	void set(const Rocket& rocket)
+	{
+		position = rocket.position;
+		direction = rocket.getDirection();
+		thruster_direction = rocket.getThrusterDirection();
+		height = rocket.height;
+		power = rocket.thruster.power;
+		avg_power = rocket.thruster.getAvgPowerRatio();
+		index = rocket.index;
+		alive = rocket.alive;
+	}
+};
+
+
 struct RocketRenderer
 {
 	sf::Texture rocket_texture;
@@ -14,12 +41,23 @@ struct RocketRenderer
 	sf::Sprite flame_sprite;
 
 	sf::Texture smoke;
-	sf::Sprite smoke_sprite;
+	sf::Vector2f smoke_origin;
+	// All the smoke quads of a frame, drawn at once
+	sf::VertexArray smoke_vertices;
 
 	sf::Font font;
 	sf::Text text;
 	sf::Text sub_text;
 
+	// Whole swarm geometry, one array per texture
+	sf::VertexArray body_vertices;
+	sf::VertexArray flame_vertices;
+	uint32_t frame_count;
+
+	static constexpr float body_width = 15.0f;
+	static constexpr float body_scale = 1.5f;
+	static constexpr float thruster_height = 20.0f;
+
 	RocketRenderer()
 	{
 		rocket_texture.loadFromFile("../res/rocket.png");
@@ -31,8 +69,8 @@ struct RocketRenderer
 		flame_sprite.setScale(0.15f, 0.15f);
 
 		smoke.loadFromFile("../res/smoke.png");
-		smoke_sprite.setTexture(smoke);
-		smoke_sprite.setOrigin(126, 134);
+		smoke_origin = sf::Vector2f(126.0f, 134.0f);
+		smoke_vertices.setPrimitiveType(sf::Quads);
 
 		font.loadFromFile("../res/font.ttf");
 		text.setFont(font);
@@ -41,49 +79,47 @@ struct RocketRenderer
 
 		sub_text = text;
 		sub_text.setCharacterSize(12);
+
+		body_vertices.setPrimitiveType(sf::Quads);
+		flame_vertices.setPrimitiveType(sf::Quads);
+		frame_count = 0;
 	}
 
-	void render(Rocket& rocket, sf::RenderTarget& target, sf::RenderStates states, bool draw_smoke)
+	void render(const Rocket& rocket, sf::RenderTarget& target, sf::RenderStates states, const std::vector<SmokeSystem::Particle>* smoke_particles = nullptr)
 	{
 		// Body
-		const float width = 15.0f;
-		sf::RectangleShape body(sf::Vector2f(rocket.height, width));
-		body.setOrigin(rocket.height * 0.5f, width * 0.5f);
-		body.setRotation(rocket.angle * RAD_TO_DEG);
+		sf::RectangleShape body(sf::Vector2f(rocket.height, body_width));
+		body.setOrigin(rocket.height * 0.5f, body_width * 0.5f);
+		const float rocket_angle = rocket.getAngle();
+		body.setRotation(rocket_angle * RAD_TO_DEG);
 		body.setPosition(rocket.position);
 		body.setTexture(&rocket_texture);
-		body.setScale(1.5f, 1.5f);
+		body.setScale(body_scale, body_scale);
 
 		// Flame
-		const float thruster_height = 20.0f;
 		const float rand_pulse_left = (1.0f + rand() % 10 * 0.05f);
 		const float v_scale_left = rocket.thruster.getAvgPowerRatio() * rand_pulse_left;
-		const float angle = rocket.angle + rocket.thruster.angle;
-		const sf::Vector2f rocket_dir(cos(rocket.angle), sin(rocket.angle));
-		const sf::Vector2f thruster_dir(cos(angle), sin(angle));
+		const float angle = rocket_angle + rocket.thruster.angle;
+		const sf::Vector2f rocket_dir = rocket.getDirection();
+		const sf::Vector2f thruster_dir = rocket.getThrusterDirection();
 		flame_sprite.setPosition(rocket.position + 0.5f * rocket.height * rocket_dir + thruster_height * thruster_dir);
 		flame_sprite.setScale(0.15f * rocket.thruster.power * rand_pulse_left, 0.15f * v_scale_left);
 		flame_sprite.setRotation(RAD_TO_DEG * (angle - HalfPI));
 
 		// Smoke
-		if (draw_smoke) {
-			for (const Smoke& s : rocket.smoke) {
-				const float smoke_scale = 0.25f * s.scale;
-				smoke_sprite.setPosition(s.position);
-				smoke_sprite.setRotation(RAD_TO_DEG * s.angle);
-				smoke_sprite.setScale(smoke_scale, smoke_scale);
-
-				const uint8_t smoke_color = static_cast<uint8_t>(255 * std::min(1.0f, 5.0f / s.scale));
-				smoke_sprite.setColor(sf::Color(smoke_color, smoke_color, smoke_color, static_cast<uint8_t>(25 * (1.0f - s.getRatio()))));
-				target.draw(smoke_sprite, states);
-			}
+		if (smoke_particles) {
+			renderSmoke(*smoke_particles, target, states);
 		}
 
 		// Render
 		target.draw(flame_sprite, states);
 		target.draw(body, states);
 
-		// Gauge
+		renderGauges(rocket, target, states);
+	}
+
+	void renderGauges(const Rocket& rocket, sf::RenderTarget& target, sf::RenderStates states)
+	{
 		const float height = 20.0f;
 		const float delta = 20.0f;
 		const float delta_y = 70.0f;
@@ -113,6 +149,115 @@ struct RocketRenderer
 		target.draw(sub_text, states);
 	}
 
+	// Bodies and flames of all alive rockets in two draw calls, geometry is built in parallel if a swarm is given
+	void renderSwarm(const std::vector<RocketState>& rockets, sf::RenderTarget& target, sf::RenderStates states, swrm::Swarm* swarm = nullptr)
+	{
+		const uint64_t count = rockets.size();
+		body_vertices.resize(4 * count);
+		flame_vertices.resize(4 * count);
+		++frame_count;
+
+		if (swarm) {
+			auto group = swarm->execute([&](uint32_t thread_id, uint32_t max_thread) {
+				const uint64_t thread_width = count / max_thread;
+				const uint64_t end = (thread_id + 1 == max_thread) ? count : (thread_id + 1) * thread_width;
+				fillSwarm(rockets, thread_id * thread_width, end);
+			});
+			group.waitExecutionDone();
+		}
+		else {
+			fillSwarm(rockets, 0, count);
+		}
+
+		states.texture = &flame;
+		target.draw(flame_vertices, states);
+		states.texture = &rocket_texture;
+		target.draw(body_vertices, states);
+	}
+
+	void fillSwarm(const std::vector<RocketState>& rockets, uint64_t begin, uint64_t end)
+	{
+		const sf::Vector2f body_texture_size(rocket_texture.getSize());
+		const sf::Vector2f flame_texture_size(flame.getSize());
+		const sf::Vector2f flame_origin = flame_sprite.getOrigin();
+		for (uint64_t i(begin); i < end; ++i) {
+			const RocketState& rocket = rockets[i];
+			sf::Vertex* body_quad = &body_vertices[4 * i];
+			sf::Vertex* flame_quad = &flame_vertices[4 * i];
+			if (!rocket.alive) {
+				// Degenerated quads are not rasterized
+				for (uint32_t k(0); k < 4; ++k) {
+					body_quad[k].position = rocket.position;
+					flame_quad[k].position = rocket.position;
+				}
+				continue;
+			}
+
+			const sf::Vector2f rocket_dir = rocket.direction;
+			const sf::Vector2f thruster_dir = rocket.thruster_direction;
+			const sf::Vector2f body_size(rocket.height, body_width);
+			setQuad(body_quad, rocket.position, rocket_dir, sf::Vector2f(body_scale, body_scale), body_size * 0.5f, body_size, body_texture_size);
+
+			// Cheap hash instead of rand() since this runs on several threads
+			const uint32_t hash = (rocket.index * 2654435761u) ^ (frame_count * 40503u);
+			const float rand_pulse = 1.0f + (hash >> 16) % 10 * 0.05f;
+			const sf::Vector2f flame_scale(0.15f * rocket.power * rand_pulse, 0.15f * rocket.avg_power * rand_pulse);
+			const sf::Vector2f flame_position = rocket.position + 0.5f * rocket.height * rocket_dir + thruster_height * thruster_dir;
+			// Rotated by the thruster angle minus PI / 2
+			setQuad(flame_quad, flame_position, sf::Vector2f(thruster_dir.y, -thruster_dir.x), flame_scale, flame_origin, flame_texture_size, flame_texture_size);
+		}
+	}
+
+	// Same transform as a sprite, rotation is given as (cos, sin)
+	static void setQuad(sf::Vertex* quad, sf::Vector2f position, sf::Vector2f rotation, sf::Vector2f scale, sf::Vector2f origin, sf::Vector2f size, sf::Vector2f texture_size)
+	{
+		const sf::Vector2f corners[4] = {
+			sf::Vector2f(0.0f, 0.0f),
+			sf::Vector2f(size.x, 0.0f),
+			size,
+			sf::Vector2f(0.0f, size.y)
+		};
+		for (uint32_t k(0); k < 4; ++k) {
+			const sf::Vector2f local((corners[k].x - origin.x) * scale.x, (corners[k].y - origin.y) * scale.y);
+			quad[k].position = position + sf::Vector2f(rotation.x * local.x - rotation.y * local.y, rotation.y * local.x + rotation.x * local.y);
+			quad[k].texCoords = sf::Vector2f(corners[k].x * texture_size.x / size.x, corners[k].y * texture_size.y / size.y);
+		}
+	}
+
+	void renderSmoke(const std::vector<SmokeSystem::Particle>& particles, sf::RenderTarget& target, sf::RenderStates states)
+	{
+		// Storage is kept from one frame to the next
+		smoke_vertices.clear();
+		const sf::Vector2f texture_size(smoke.getSize());
+		const sf::Vector2f corners[4] = {
+			-smoke_origin,
+			sf::Vector2f(texture_size.x, 0.0f) - smoke_origin,
+			texture_size - smoke_origin,
+			sf::Vector2f(0.0f, texture_size.y) - smoke_origin
+		};
+		const sf::Vector2f tex_coords[4] = {
+			sf::Vector2f(0.0f, 0.0f),
+			sf::Vector2f(texture_size.x, 0.0f),
+			texture_size,
+			sf::Vector2f(0.0f, texture_size.y)
+		};
+
+		for (const SmokeSystem::Particle& s : particles) {
+			const float smoke_scale = 0.25f * s.scale;
+			const float ca = smoke_scale * cos(s.angle);
+			const float sa = smoke_scale * sin(s.angle);
+			const uint8_t smoke_color = static_cast<uint8_t>(255 * std::min(1.0f, 5.0f / s.scale));
+			const sf::Color color(smoke_color, smoke_color, smoke_color, static_cast<uint8_t>(25 * (1.0f - s.ratio)));
+			for (uint32_t i(0); i < 4; ++i) {
+				const sf::Vector2f& c = corners[i];
+				smoke_vertices.append(sf::Vertex(s.position + sf::Vector2f(ca * c.x - sa * c.y, sa * c.x + ca * c.y), color, tex_coords[i]));
+			}
+		}
+
+		states.texture = &smoke;
+		target.draw(smoke_vertices, states);
+	}
+
 	static void drawPie(float radius, float angle, sf::Color color, sf::Vector2f position, sf::RenderTarget& target, sf::RenderStates states)
 	{
 		const uint32_t quality = 16;
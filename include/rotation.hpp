@@ -0,0 +1,29 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+
+
+// Orientations stored as unit complex numbers (cos a, sin a)
+struct Rotation
+{
+	// Complex product, angles add up
+	static sf::Vector2f compose(sf::Vector2f r1, sf::Vector2f r2)
+	{
+		return sf::Vector2f(r1.x * r2.x - r1.y * r2.y, r1.x * r2.y + r1.y * r2.x);
+	}
+
+	// Rotates by a small angle with a fourth order expansion then brings the norm back to 1
+	static sf::Vector2f rotate(sf::Vector2f r, float da)
+	{
+		const float da2 = da * da;
+		const float c = 1.0f - 0.5f * da2 * (1.0f - da2 / 12.0f);
+		const float s = da * (1.0f - da2 / 6.0f);
+		return renormalize(compose(r, sf::Vector2f(c, s)));
+	}
+
+	// One Newton step of 1/sqrt(n) around 1, enough for almost unit vectors
+	static sf::Vector2f renormalize(sf::Vector2f r)
+	{
+		const float n = r.x * r.x + r.y * r.y;
+		return r * (0.5f * (3.0f - n));
+	}
+};
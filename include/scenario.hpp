@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <SFML/Graphics.hpp>
+#include "utils.hpp"
+
+
+struct Scenario
+{
+	uint32_t seed;
+	std::vector<sf::Vector2f> targets;
+	float gravity;
+	float thrust_factor;
+
+	Scenario()
+		: seed(0)
+		, gravity(1000.0f)
+		, thrust_factor(1.0f)
+	{}
+
+	// Everything is derived from the seed so the same scenario can be rebuilt anywhere
+	void generate(uint32_t scenario_seed, sf::Vector2f area_size, uint32_t targets_count, float physics_variation)
+	{
+		seed = scenario_seed;
+		std::mt19937 generator(seed);
+
+		const float border_x = 360.0f;
+		const float border_y = 290.0f;
+		targets.resize(targets_count);
+		for (uint32_t i(0); i < targets_count - 1; ++i) {
+			const float x = border_x + getRandUnder(area_size.x - 2.0f * border_x, generator);
+			const float y = border_y + getRandUnder(area_size.y - 2.0f * border_y, generator);
+			targets[i] = sf::Vector2f(x, y);
+		}
+		targets[targets_count - 1] = sf::Vector2f(area_size.x * 0.5f, 900.0f);
+
+		gravity = 1000.0f;
+		thrust_factor = 1.0f;
+		if (physics_variation > 0.0f) {
+			gravity *= 1.0f + getRandRange(physics_variation, generator);
+			thrust_factor += getRandRange(physics_variation, generator);
+		}
+	}
+};
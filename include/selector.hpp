@@ -3,10 +3,11 @@
 #include "neural_network.hpp"
 #include "selection_wheel.hpp"
 #include "unit.hpp"
-#include "double_buffer.hpp"
 #include <fstream>
 #include <sstream>
 #include "dna_loader.hpp"
+#include "profiler.hpp"
+#include "optimizer.hpp"
 
 
 const float population_elite_ratio = 0.05f;
@@ -19,11 +20,16 @@ struct Selector
 	const uint32_t population_size;
 	const uint32_t survivings_count;
 	const uint32_t elites_count;
-	DoubleObject<std::vector<T>> population;
+	std::vector<T> population;
+	// Copies of the survivors, children are bred from them and written over the population
+	std::vector<T> parents;
 	SelectionWheel wheel;
 	std::string out_file;
 	uint32_t dump_frequency = 10;
 	uint32_t current_iteration;
+	// Exchanged with optimizers
+	std::vector<DNA> genomes;
+	std::vector<float> genomes_fitness;
 
 	Selector(const uint32_t agents_count)
 		: population(agents_count)
@@ -33,93 +39,97 @@ struct Selector
 		, elites_count(as<uint32_t>(agents_count * population_elite_ratio))
 		, wheel(survivings_count)
 	{
-		const std::string base_filename = "../selector_output";
-		std::string filename = base_filename + ".bin";
-		std::ifstream ifs(filename);
-		uint32_t try_count = 0;
-		while (ifs) {
-			ifs.close();
-			++try_count;
-			std::stringstream sstr;
-			sstr << base_filename << "_" << try_count << ".bin";
-			filename = sstr.str();
-			ifs.open(filename);
-		}
-		ifs.close();
-		out_file = filename;
-
-		std::cout << "Writing dumps in " << filename << std::endl;
+		out_file = getAvailableFilename("../selector_output", ".bin");
+		std::cout << "Writing dumps in " << out_file << std::endl;
 	}
 
 	void nextGeneration()
 	{
+		Profiler::Timer timer;
 		// Create selection wheel
 		sortCurrentPopulation();
-		std::vector<T>& current_units = population.getCurrent();
-		std::vector<T>& next_units    = population.getLast();
-		wheel.addFitnessScores(current_units);
+		std::vector<T>& units = population;
+		// Only the survivors can be picked, their copies reuse the buffers of the last generation
+		parents.assign(units.begin(), units.begin() + survivings_count);
+		wheel.addFitnessScores(parents);
 		// Replace the weakest
-		std::cout << "Gen: " << current_iteration << " Best: " << current_units[0].fitness << std::endl;
+		std::cout << "Gen: " << current_iteration << " Best: " << units[0].fitness << std::endl;
+		timer.lap(Profiler::Breeding);
 		if ((current_iteration%dump_frequency) == 0) {
-			DnaLoader::writeDnaToFile(out_file, getCurrentPopulation()[0].dna);
+			DnaLoader::writeDnaToFile(out_file, units[0].dna);
 		}
+		timer.lap(Profiler::DnaIO);
 
-		// The top best survive;
+		// Children are written straight in the genomes of the population, no allocation
+		// The top best survive in place;
 		uint32_t evolve_count = 0;
-		for (uint32_t i(0); i < elites_count; ++i) {
-			next_units[i] = current_units[i];
-		}
 		for (uint32_t i(elites_count); i < population_size; ++i) {
-			const T& unit_1 = wheel.pick(current_units);
-			const T& unit_2 = wheel.pick(current_units);
+			const T& unit_1 = wheel.pick(parents);
+			const T& unit_2 = wheel.pick(parents);
 			const float mutation_proba = 1.0f / sqrt(unit_1.fitness + unit_2.fitness);
 			if (unit_1.dna == unit_2.dna) {
 				++evolve_count;
-				next_units[i].loadDNA(DNAUtils::evolve<float>(unit_1.dna, mutation_proba, mutation_proba));
+				DNAUtils::evolve<float>(unit_1.dna, mutation_proba, mutation_proba, units[i].dna);
 			}
 			else {
-				next_units[i].loadDNA(DNAUtils::makeChild<float>(unit_1.dna, unit_2.dna, mutation_proba));
+				DNAUtils::makeChild<float>(unit_1.dna, unit_2.dna, mutation_proba, units[i].dna);
 			}
+			units[i].reloadDNA();
 		}
 
-		switchPopulation();
+		++current_iteration;
+		timer.lap(Profiler::Breeding);
 	}
 
-	void sortCurrentPopulation()
+	// Same as nextGeneration but the next genomes are given by an optimizer
+	void nextGeneration(Optimizer& optimizer)
 	{
-		std::vector<T>& current_units = population.getCurrent();
-		std::sort(current_units.begin(), current_units.end(), [&](const T& a1, const T& a2) {return a1.fitness > a2.fitness; });
-	}
+		Profiler::Timer timer;
+		std::vector<T>& units = population;
+		genomes.resize(population_size, DNA(0));
+		genomes_fitness.resize(population_size);
+		// In evaluation order, some optimizers pair genomes with the ones they asked
+		for (uint32_t i(0); i < population_size; ++i) {
+			genomes[i] = units[i].dna;
+			genomes_fitness[i] = units[i].fitness;
+		}
+		optimizer.tell(genomes, genomes_fitness);
+		optimizer.ask(genomes);
 
-	const T& getBest() const
-	{
-		return getNextPopulation()[0];
-	}
+		// The best of this generation is kept aside before being replaced
+		sortCurrentPopulation();
+		parents.assign(units.begin(), units.begin() + 1);
+		std::cout << "Gen: " << current_iteration << " Best: " << units[0].fitness << std::endl;
+		timer.lap(Profiler::Breeding);
+		if ((current_iteration%dump_frequency) == 0) {
+			DnaLoader::writeDnaToFile(out_file, units[0].dna);
+		}
+		timer.lap(Profiler::DnaIO);
 
-	void switchPopulation()
-	{
-		population.swap();
+		for (uint32_t i(0); i < population_size; ++i) {
+			units[i].loadDNA(genomes[i]);
+		}
 		++current_iteration;
 	}
 
-	std::vector<T>& getCurrentPopulation()
+	void sortCurrentPopulation()
 	{
-		return population.getCurrent();
+		std::sort(population.begin(), population.end(), [&](const T& a1, const T& a2) {return a1.fitness > a2.fitness; });
 	}
 
-	const std::vector<T>& getCurrentPopulation() const
+	// Best of the last generation, or any unit before the first one
+	const T& getBest() const
 	{
-		return population.getCurrent();
+		return parents.empty() ? population[0] : parents[0];
 	}
 
-	std::vector<T>& getNextPopulation()
+	std::vector<T>& getCurrentPopulation()
 	{
-		return population.getLast();
+		return population;
 	}
 
-	const std::vector<T>& getNextPopulation() const
+	const std::vector<T>& getCurrentPopulation() const
 	{
-		return population.getLast();
+		return population;
 	}
 };
-
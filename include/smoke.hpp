@@ -1,60 +1,192 @@
 #pragma once
 
+#include <vector>
+#include <algorithm>
 #include <SFML/Graphics.hpp>
 #include "utils.hpp"
 
 
-struct Smoke
+/*
+	Smoke particles of the displayed rockets, stored as structure of arrays in fixed size rings.
+	Each thread emits in and updates its own lane so nothing is locked or allocated,
+	when a lane is full its oldest particles are overwritten.
+*/
+struct SmokeSystem
 {
-	sf::Vector2f position;
-	sf::Vector2f direction;
-	float speed;
-	float angle;
-	float scale;
-	float max_lifetime;
-	float lifetime;
-	float angle_var;
-	bool hit;
+	static constexpr float ground_level = 990.0f;
 
-	Smoke(sf::Vector2f pos, sf::Vector2f dir, float speed_, float scale_, float duration)
-		: position(pos)
-		, direction(dir)
-		, speed(speed_)
-		, angle(getFastRandUnder(2.0f * PI))
-		, scale(0.25f + scale_ * (0.25f + getFastRandUnder(1.0f)))
-		, max_lifetime(duration)
-		, lifetime(0.0f)
-		, angle_var(1.0f * (getFastRandUnder(2.0f) - 1.0f))
-		, hit(false)
+	struct alignas(64) Lane
 	{
+		std::vector<float> position_x;
+		std::vector<float> position_y;
+		std::vector<float> direction_x;
+		std::vector<float> direction_y;
+		std::vector<float> speed;
+		std::vector<float> angle;
+		std::vector<float> angle_var;
+		std::vector<float> scale;
+		std::vector<float> lifetime;
+		std::vector<float> max_lifetime;
+		std::vector<uint32_t> emitter;
+		std::vector<uint8_t> hit;
+		// Particles alive are in [tail, head), indexes are masked when accessed
+		uint64_t head;
+		uint64_t tail;
+		// Only used by the lane's thread
+		uint32_t random_state;
+
+		void resize(uint64_t capacity)
+		{
+			for (std::vector<float>* v : { &position_x, &position_y, &direction_x, &direction_y, &speed, &angle, &angle_var, &scale, &lifetime, &max_lifetime }) {
+				v->resize(capacity);
+			}
+			emitter.resize(capacity);
+			hit.resize(capacity);
+		}
+
+		// xorshift32
+		float getRandUnder(float max)
+		{
+			random_state ^= random_state << 13;
+			random_state ^= random_state >> 17;
+			random_state ^= random_state << 5;
+			return max * float(random_state >> 8) * (1.0f / 16777216.0f);
+		}
+	};
+
+	// What the renderer needs to know about a particle
+	struct Particle
+	{
+		sf::Vector2f position;
+		float angle;
+		float scale;
+		float ratio;
+	};
+
+	// lane_capacity is rounded up to a power of two so that indexes can be masked
+	// The default holds a few seconds of one rocket's trail at any time step
+	SmokeSystem(uint32_t lanes_count, uint32_t lane_capacity = 1u << 12)
+		: capacity_mask(getNextPowerOfTwo(lane_capacity) - 1)
+		, lanes(lanes_count)
+	{
+		for (uint32_t i(0); i < lanes_count; ++i) {
+			lanes[i].resize(capacity_mask + 1);
+			lanes[i].random_state = 0x9E3779B9u * (i + 1);
+		}
+		clear();
+	}
+
+	void clear()
+	{
+		for (Lane& lane : lanes) {
+			lane.head = 0;
+			lane.tail = 0;
+		}
+	}
+
+	void emit(uint32_t lane_id, uint32_t emitter_id, sf::Vector2f position, sf::Vector2f direction, float speed, float scale, float duration)
+	{
+		Lane& lane = lanes[lane_id];
+		if (lane.head - lane.tail > capacity_mask) {
+			++lane.tail;
+		}
+
+		const uint64_t i = lane.head & capacity_mask;
+		lane.position_x[i] = position.x;
+		lane.position_y[i] = position.y;
+		lane.direction_x[i] = direction.x;
+		lane.direction_y[i] = direction.y;
+		lane.speed[i] = speed;
+		lane.angle[i] = lane.getRandUnder(2.0f * PI);
+		lane.scale[i] = 0.25f + scale * (0.25f + lane.getRandUnder(1.0f));
+		lane.angle_var[i] = lane.getRandUnder(2.0f) - 1.0f;
+		lane.lifetime[i] = 0.0f;
+		lane.max_lifetime[i] = duration;
+		lane.emitter[i] = emitter_id;
+		lane.hit[i] = 0;
+		++lane.head;
+	}
+
+	void update(uint32_t lane_id, float dt)
+	{
+		Lane& lane = lanes[lane_id];
+		// The ring is processed as at most two contiguous ranges
+		const uint64_t begin = lane.tail & capacity_mask;
+		const uint64_t count = lane.head - lane.tail;
+		const uint64_t first_end = std::min(begin + count, capacity_mask + 1);
+		updateRange(lane, begin, first_end, dt);
+		updateRange(lane, 0, count - (first_end - begin), dt);
+
+		// Particles don't all last the same time, only the oldest ones are retired
+		while (lane.tail < lane.head && isDone(lane, lane.tail & capacity_mask)) {
+			++lane.tail;
+		}
+	}
+
+	template<typename Callback>
+	void forEach(uint32_t emitter_id, Callback&& callback) const
+	{
+		for (const Lane& lane : lanes) {
+			for (uint64_t n(lane.tail); n < lane.head; ++n) {
+				const uint64_t i = n & capacity_mask;
+				if (lane.emitter[i] == emitter_id && !isDone(lane, i)) {
+					callback(Particle{ sf::Vector2f(lane.position_x[i], lane.position_y[i]), lane.angle[i], lane.scale[i], lane.lifetime[i] / lane.max_lifetime[i] });
+				}
+			}
+		}
 	}
 
-	float getRatio() const
+	uint64_t getCount() const
 	{
-		return lifetime / max_lifetime;
+		uint64_t result = 0;
+		for (const Lane& lane : lanes) {
+			result += lane.head - lane.tail;
+		}
+		return result;
 	}
 
-	bool done() const
+	const uint64_t capacity_mask;
+	std::vector<Lane> lanes;
+
+	static bool isDone(const Lane& lane, uint64_t i)
 	{
-		return lifetime >= max_lifetime;
+		return lane.lifetime[i] >= lane.max_lifetime[i];
 	}
 
-	void update(float dt)
+	// Branch free so that the compiler can vectorize it, bounces are handled after
+	static void integrate(Lane& lane, uint64_t begin, uint64_t end, float dt)
 	{
-		const float ratio = getRatio();
-		const float inv_ratio = (1.0f - ratio);
-		lifetime += dt;
-		angle += angle_var * dt;
-		scale *= 1.0f + 2.5f * dt;
-		position += (speed * direction * dt) / scale;
+		float* __restrict position_x = lane.position_x.data();
+		float* __restrict position_y = lane.position_y.data();
+		const float* __restrict direction_x = lane.direction_x.data();
+		const float* __restrict direction_y = lane.direction_y.data();
+		const float* __restrict speed = lane.speed.data();
+		float* __restrict angle = lane.angle.data();
+		const float* __restrict angle_var = lane.angle_var.data();
+		float* __restrict scale = lane.scale.data();
+		float* __restrict lifetime = lane.lifetime.data();
+		const float growth = 1.0f + 2.5f * dt;
+		for (uint64_t i(begin); i < end; ++i) {
+			lifetime[i] += dt;
+			angle[i] += angle_var[i] * dt;
+			scale[i] *= growth;
+			const float move = speed[i] * dt / scale[i];
+			position_x[i] += direction_x[i] * move;
+			position_y[i] += direction_y[i] * move;
+		}
+	}
 
-		if (!hit && position.y > 990.0f) {
-			hit = true;
-			const float old_dir_x = direction.x;
-			const float new_dir_x = getFastRandUnder(1.0f) > 0.5f ? -1.0f : 1.0f;
-			position.y = 990.0f;
-			direction.x = new_dir_x * direction.y;
-			direction.y = -getFastRandUnder(scale * 0.5f);
+	static void updateRange(Lane& lane, uint64_t begin, uint64_t end, float dt)
+	{
+		integrate(lane, begin, end, dt);
+		for (uint64_t i(begin); i < end; ++i) {
+			if (!lane.hit[i] && lane.position_y[i] > ground_level) {
+				lane.hit[i] = 1;
+				const float new_dir_x = lane.getRandUnder(1.0f) > 0.5f ? -1.0f : 1.0f;
+				lane.position_y[i] = ground_level;
+				lane.direction_x[i] = new_dir_x * lane.direction_y[i];
+				lane.direction_y[i] = -lane.getRandUnder(lane.scale[i] * 0.5f);
+			}
 		}
 	}
 };
@@ -1,10 +1,17 @@
 #pragma once
 
 #include <swarm.hpp>
+#include <limits>
 
 #include "selector.hpp"
 #include "rocket.hpp"
 #include "objective.hpp"
+#include "scenario.hpp"
+#include "fitness_cache.hpp"
+#include "telemetry_recorder.hpp"
+#include "live_stats.hpp"
+#include "profiler.hpp"
+#include "cpu_topology.hpp"
 
 
 struct Stadium
@@ -12,38 +19,122 @@ struct Stadium
 	struct Iteration
 	{
 		float time;
+		uint32_t step;
 		float best_fitness;
+		uint32_t cached_count;
 
 		void reset()
 		{
 			time = 0.0f;
+			step = 0;
 			best_fitness = 0.0f;
+			cached_count = 0;
 		}
 	};
 
+	// Per thread buffers used to run a genome's network on all its scenarios at once
+	struct EvaluationBatch
+	{
+		std::vector<float> inputs;
+		std::vector<float> outputs;
+		std::vector<float> distances;
+		// Intermediate layers values
+		std::vector<float> scratch;
+		// Network slot of each scenario or one of the special values below
+		std::vector<int32_t> slots;
+		uint32_t thread_id;
+		int64_t busy_time;
+		// Steps during which at least one genome of the worker was alive, in blocked mode
+		uint32_t active_steps;
+
+		static constexpr int32_t Dead = -2;
+		static constexpr int32_t NoNetwork = -1;
+	};
+
 	uint32_t population_size;
+	uint32_t scenarios_count;
 	Selector<Rocket> selector;
+	std::vector<Rocket> replicas;
 	uint32_t targets_count;
-	std::vector<sf::Vector2f> targets;
+	std::vector<Scenario> scenarios;
+	float physics_variation;
 	std::vector<Objective> objectives;
 	sf::Vector2f area_size;
 	Iteration current_iteration;
+	CpuTopology topology;
+	uint32_t thread_count;
+	std::vector<EvaluationBatch> batches;
+	// Scenarios are only drawn again every scenarios_renewal generations
+	uint32_t scenarios_renewal;
+	bool use_fitness_cache;
+	// Physics mode of the rockets, see Rocket::rotation_vectors
+	bool rotation_vectors;
+	FitnessCache fitness_cache;
+	std::vector<uint64_t> genome_hashes;
+	std::unique_ptr<TelemetryRecorder> recorder;
+	std::unique_ptr<LiveStats> live_stats;
+	// Replaces the selector's genetic algorithm when set
+	std::unique_ptr<Optimizer> optimizer;
+	// Smoke of the displayed genome's first body, one lane per thread
+	SmokeSystem smoke;
+	// Only the displayed genome emits, a lane could not hold the trails of all of them
+	uint32_t smoke_emitter;
 	swrm::Swarm swarm;
 
-	Stadium(uint32_t population, sf::Vector2f size)
+	static constexpr uint32_t NoSmokeEmitter = 0xFFFFFFFF;
+
+	// With threads at 0 there is one thread per physical core
+	Stadium(uint32_t population, sf::Vector2f size, uint32_t scenarios_per_genome = 1, uint32_t threads = 0, bool pin_threads = false)
 		: population_size(population)
+		, scenarios_count(std::max(1u, scenarios_per_genome))
 		, selector(population)
+		, replicas(population * (scenarios_count - 1), Rocket(Rocket::Replica()))
 		, targets_count(8)
-		, targets(targets_count)
-		, objectives(population)
+		, scenarios(scenarios_count)
+		, physics_variation(scenarios_count > 1 ? 0.1f : 0.0f)
+		, objectives(population * scenarios_count)
 		, area_size(size)
-		, swarm(4)
+		, thread_count(threads ? threads : topology.getDefaultThreadCount())
+		, batches(thread_count)
+		, scenarios_renewal(1)
+		, use_fitness_cache(false)
+		, rotation_vectors(false)
+		, genome_hashes(population, 0)
+		, smoke(thread_count)
+		, smoke_emitter(NoSmokeEmitter)
+		, swarm(thread_count, pin_threads ? topology.getPinningOrder() : std::vector<int32_t>())
+	{
+		for (uint32_t i(0); i < thread_count; ++i) {
+			batches[i].thread_id = i;
+			batches[i].active_steps = 0;
+		}
+		Profiler::getInstance().setThreadCount(thread_count);
+		initializeScenarios();
+		if (swarm.getPinnedCount()) {
+			placeUnits();
+		}
+	}
+
+	// Copies each worker's rockets from the worker itself so that their networks and DNA are
+	// first touched, thus allocated, on its NUMA node. The rockets' own structs stay where they are
+	void placeUnits()
 	{
-		initializeTargets();
+		auto group = swarm.execute([&](uint32_t thread_id, uint32_t max_thread) {
+			const uint64_t thread_width = population_size / max_thread;
+			const uint64_t end = (thread_id + 1 == max_thread) ? population_size : (thread_id + 1) * thread_width;
+			for (uint64_t i(thread_id * thread_width); i < end; ++i) {
+				for (uint32_t k(0); k < scenarios_count; ++k) {
+					Rocket& r = getBody(i, k);
+					r = Rocket(r);
+				}
+			}
+		});
+		group.waitExecutionDone();
 	}
 
 	void loadDnaFromFile(const std::string& filename)
 	{
+		Profiler::Scope scope(Profiler::DnaIO);
 		const uint64_t bytes_count = Network::getParametersCount(architecture) * 4;
 		const uint64_t dna_count = DnaLoader::getDnaCount(filename, bytes_count);
 		for (uint64_t i(0); i < dna_count && i < population_size; ++i) {
@@ -52,30 +143,113 @@ struct Stadium
 		}
 	}
 
-	void initializeTargets()
+	void initializeScenarios()
+	{
+		const uint32_t base_seed = getIntUnder(std::numeric_limits<uint32_t>::max() - scenarios_count);
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			scenarios[k].generate(base_seed + k, area_size, targets_count, physics_variation);
+		}
+	}
+
+	// The first scenario is evaluated on the genome's rocket itself, the others on replicas
+	Rocket& getBody(uint64_t i, uint32_t scenario_id)
 	{
-		// Initialize targets
-		const float border_x = 360.0f;
-		const float border_y = 290.0f;
-		for (uint32_t i(0); i < targets_count - 1; ++i) {
-			targets[i] = sf::Vector2f(border_x + getRandUnder(area_size.x - 2.0f * border_x), border_y + getRandUnder(area_size.y - 2.0f * border_y));
+		if (!scenario_id) {
+			return selector.getCurrentPopulation()[i];
 		}
+		return replicas[i * (scenarios_count - 1) + scenario_id - 1];
+	}
 
-		targets[targets_count-1] = sf::Vector2f(area_size.x * 0.5f, 900.0f);
+	const Rocket& getBody(uint64_t i, uint32_t scenario_id) const
+	{
+		if (!scenario_id) {
+			return selector.getCurrentPopulation()[i];
+		}
+		return replicas[i * (scenarios_count - 1) + scenario_id - 1];
+	}
+
+	// Memory used for each genome: its rocket, its share of the selector's parents, its replicas and their objectives
+	uint64_t getBytesPerGenome() const
+	{
+		uint64_t result = getBody(0, 0).getBytesCount() * (population_size + selector.survivings_count) / population_size;
+		for (uint32_t k(1); k < scenarios_count; ++k) {
+			result += getBody(0, k).getBytesCount();
+		}
+		result += scenarios_count * sizeof(Objective) + sizeof(uint64_t);
+		return result;
+	}
+
+	Objective& getObjective(uint64_t i, uint32_t scenario_id)
+	{
+		return objectives[i * scenarios_count + scenario_id];
+	}
+
+	const Objective& getObjective(uint64_t i, uint32_t scenario_id) const
+	{
+		return objectives[i * scenarios_count + scenario_id];
+	}
+
+	void initializeBody(Rocket& r, Objective& objective, const Scenario& scenario) const
+	{
+		r.position = sf::Vector2f(area_size.x * 0.5f, area_size.y * 0.75f);
+		r.gravity = scenario.gravity;
+		r.thruster.max_power = Rocket::Thruster::nominal_power * scenario.thrust_factor;
+		r.rotation_vectors = rotation_vectors;
+		objective.reset();
+		objective.points = getLength(r.position - scenario.targets[0]);
+		r.reset();
 	}
 
 	void initializeUnits()
 	{
-		// Initialize targets
-		auto& rockets = selector.getCurrentPopulation();
-		uint32_t i = 0;
-		for (Rocket& r : rockets) {
-			r.index = i++;
-			Objective& objective = objectives[r.index];
-			r.position = sf::Vector2f(area_size.x * 0.5f, area_size.y * 0.75f);
-			objective.reset();
-			objective.points = getLength(r.position - targets[0]);
-			r.reset();
+		const auto& rockets = selector.getCurrentPopulation();
+		for (uint32_t i(0); i < population_size; ++i) {
+			if (use_fitness_cache) {
+				genome_hashes[i] = rockets[i].dna.getHash();
+			}
+
+			for (uint32_t k(0); k < scenarios_count; ++k) {
+				Rocket& r = getBody(i, k);
+				r.index = i;
+				initializeBody(r, getObjective(i, k), scenarios[k]);
+				if (use_fitness_cache) {
+					loadCachedFitness(r, i, k);
+				}
+			}
+			// A genome known on all scenarios won't be updated, it still competes for the best
+			if (use_fitness_cache && !isAlive(i)) {
+				checkBestFitness(getFitness(i));
+			}
+		}
+		if (live_stats) {
+			live_stats->setAliveCount(uint64_t(population_size) * scenarios_count - current_iteration.cached_count);
+		}
+	}
+
+	// Evaluation is deterministic so a known result doesn't need to be simulated again
+	void loadCachedFitness(Rocket& r, uint64_t i, uint32_t scenario_id)
+	{
+		FitnessCache::Entry entry;
+		if (fitness_cache.get(genome_hashes[i], scenarios[scenario_id].seed, entry)) {
+			r.fitness = entry.fitness;
+			r.time = entry.time;
+			getObjective(i, scenario_id).target_id = entry.target_id;
+			r.alive = false;
+			++current_iteration.cached_count;
+		}
+	}
+
+	void storeFitness()
+	{
+		if (!use_fitness_cache) {
+			return;
+		}
+
+		for (uint32_t i(0); i < population_size; ++i) {
+			for (uint32_t k(0); k < scenarios_count; ++k) {
+				const Rocket& r = getBody(i, k);
+				fitness_cache.add(genome_hashes[i], scenarios[k].seed, { r.fitness, r.time, getObjective(i, k).target_id });
+			}
 		}
 	}
 
@@ -83,66 +257,101 @@ struct Stadium
 	{
 		const sf::Vector2f tolerance_margin = sf::Vector2f(tolerance, tolerance);
 		const bool in_window = sf::FloatRect(-tolerance_margin, area_size + tolerance_margin).contains(rocket.position);
-		return in_window && sin(rocket.angle) > 0.0f;
+		return in_window && rocket.getDirection().y > 0.0f;
+	}
+
+	bool isAlive(uint64_t i) const
+	{
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			if (getBody(i, k).alive) {
+				return true;
+			}
+		}
+		return false;
 	}
 
 	uint32_t getAliveCount() const
 	{
 		uint32_t result = 0;
-		const auto& rockets = selector.getCurrentPopulation();
-		for (const Rocket& r : rockets) {
-			result += r.alive;
+		for (uint32_t i(0); i < population_size; ++i) {
+			result += isAlive(i);
 		}
 
 		return result;
 	}
 
-	void updateUnit(uint64_t i, float dt, bool update_smoke)
+	// Mean fitness of a genome over all its scenarios
+	float getFitness(uint64_t i) const
 	{
-		Rocket& r = selector.getCurrentPopulation()[i];
-		if (!r.alive) {
-			// It's too late for it
-			return;
+		float sum = 0.0f;
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			sum += getBody(i, k).fitness;
 		}
+		return sum / float(scenarios_count);
+	}
 
-		const float target_radius = 8.0f;
+	// Network inputs of a rocket, to_target_dist is also needed to score it
+	void writeInputs(const Rocket& r, const Objective& objective, const Scenario& scenario, float dt, float* inputs, float& to_target_dist) const
+	{
 		const float max_dist = 500.0f;
-		const float tolerance_margin = 50.0f;
-		
-		Objective& objective = objectives[r.index];
-		sf::Vector2f to_target = objective.getTarget(targets) - r.position;
-		const float to_target_dist = getLength(to_target);
+
+		sf::Vector2f to_target = scenario.targets[objective.target_id] - r.position;
+		to_target_dist = getLength(to_target);
 		to_target.x /= std::max(to_target_dist, max_dist);
 		to_target.y /= std::max(to_target_dist, max_dist);
 
+		inputs[0] = to_target.x;
+		inputs[1] = to_target.y;
+		inputs[2] = r.velocity.x * dt;
+		inputs[3] = r.velocity.y * dt;
+		const sf::Vector2f direction = r.getDirection();
+		inputs[4] = direction.x;
+		inputs[5] = direction.y;
+		inputs[6] = r.angular_velocity * dt;
+	}
+
+	// Updates the objective and writes the network inputs, returns false if the network is not needed
+	bool prepareStep(Rocket& r, Objective& objective, const Scenario& scenario, float dt, float* inputs, float& to_target_dist) const
+	{
+		writeInputs(r, objective, scenario, dt, inputs, to_target_dist);
 		if (objective.target_id == targets_count - 1) {
 			objective.time_in = 0.0f;
-			if (to_target_dist < 1.0f && std::abs(r.angle - HalfPI) < 0.01f) {
+			if (to_target_dist < 1.0f && std::abs(r.getAngle() - HalfPI) < 0.01f) {
 				r.stop = true;
 			}
 		}
+		return !r.stop;
+	}
+
+	// Applies the network outputs if any, moves the rocket and updates its fitness
+	void finishStep(Rocket& r, Objective& objective, const Scenario& scenario, const float* outputs, float to_target_dist, float dt) const
+	{
+		moveBody(r, outputs, dt);
+		scoreBody(r, objective, scenario, to_target_dist, dt);
+	}
+
+	void moveBody(Rocket& r, const float* outputs, float dt) const
+	{
+		const float tolerance_margin = 50.0f;
 
-		const std::vector<float> inputs = {
-			to_target.x,
-			to_target.y,
-			r.velocity.x * dt,
-			r.velocity.y * dt,
-			cos(r.angle),
-			sin(r.angle),
-			r.angular_velocity * dt
-		};
 		// The actual update
-		if (!r.stop) {
-			r.execute(inputs);
+		if (outputs) {
+			r.process(outputs);
 		}
-		r.update(dt, update_smoke);
+		r.update(dt);
 		r.alive = checkAlive(r, tolerance_margin);
+	}
+
+	void scoreBody(Rocket& r, Objective& objective, const Scenario& scenario, float to_target_dist, float dt) const
+	{
+		const float target_radius = 8.0f;
+
 		// Fitness stuffs
 		const float jerk_malus = std::abs(r.last_power - r.thruster.power);
 		const float move_malus = 0.1f * getLength(r.velocity * dt);
 		r.fitness += 10.0f * jerk_malus / (1.0f + to_target_dist);
 		// We don't want weirdos
-		const float score_factor = std::pow(sin(r.angle), 2.0f);
+		const float score_factor = std::pow(r.getDirection().y, 2.0f);
 		const float target_reward_coef = score_factor * 10.0f;
 		const float target_time = 1.0f;
 		if (to_target_dist < target_radius) {
@@ -150,15 +359,127 @@ struct Stadium
 			if (objective.time_in > target_time) {
 				r.fitness += target_reward_coef * objective.points / (1.0f + objective.time_out + to_target_dist);
 				//r.fitness += objective.time_in;
-				objective.nextTarget(targets);
-				objective.points = getLength(r.position - objective.getTarget(targets));
+				objective.nextTarget(scenario.targets);
+				objective.points = getLength(r.position - objective.getTarget(scenario.targets));
 			}
 		}
 		else {
 			objective.addTimeOut(dt);
 		}
+	}
+
+	// Returns false if the genome has nothing left to simulate
+	bool updateUnit(uint64_t i, float dt, uint32_t step, bool update_smoke, EvaluationBatch& batch, Profiler::Timer& timer)
+	{
+		if (!isAlive(i)) {
+			// It's too late for it
+			return false;
+		}
+
+		Network& network = selector.getCurrentPopulation()[i].network;
+		const uint64_t inputs_count = network.getInputSize();
+		const uint64_t outputs_count = network.getOutputSize();
+		batch.inputs.resize(scenarios_count * inputs_count);
+		batch.outputs.resize(scenarios_count * outputs_count);
+		batch.distances.resize(scenarios_count);
+		batch.slots.resize(scenarios_count);
+
+		// Gather the inputs of all scenarios still running
+		uint32_t batch_size = 0;
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			Rocket& r = getBody(i, k);
+			batch.slots[k] = EvaluationBatch::Dead;
+			if (r.alive) {
+				const bool use_network = prepareStep(r, getObjective(i, k), scenarios[k], dt, &batch.inputs[batch_size * inputs_count], batch.distances[k]);
+				batch.slots[k] = use_network ? batch_size++ : EvaluationBatch::NoNetwork;
+			}
+		}
+		timer.lap(Profiler::Inputs);
+		// One pass over the weights for all of them
+		network.executeBatch(batch.inputs.data(), batch_size, batch.outputs.data(), batch.scratch);
+		timer.lap(Profiler::Inference);
+
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			const int32_t slot = batch.slots[k];
+			if (slot != EvaluationBatch::Dead) {
+				moveBody(getBody(i, k), slot < 0 ? nullptr : &batch.outputs[slot * outputs_count], dt);
+			}
+		}
+		timer.lap(Profiler::Physics);
+
+		if (update_smoke && i == smoke_emitter && batch.slots[0] != EvaluationBatch::Dead) {
+			getBody(i, 0).emitSmoke(smoke, batch.thread_id);
+			timer.lap(Profiler::Smoke);
+		}
 
-		checkBestFitness(r.fitness);
+		uint32_t steps_count = 0;
+		uint32_t deaths_count = 0;
+		for (uint32_t k(0); k < scenarios_count; ++k) {
+			if (batch.slots[k] != EvaluationBatch::Dead) {
+				Rocket& r = getBody(i, k);
+				scoreBody(r, getObjective(i, k), scenarios[k], batch.distances[k], dt);
+				if (recorder && recorder->isRecorded(as<uint32_t>(i), step)) {
+					recordStep(r, getObjective(i, k), as<uint32_t>(i), k, step, batch.thread_id);
+				}
+				++steps_count;
+				deaths_count += !r.alive;
+			}
+		}
+		if (live_stats) {
+			live_stats->addSteps(batch.thread_id, steps_count, -int64_t(deaths_count));
+		}
+
+		checkBestFitness(getFitness(i));
+		timer.lap(Profiler::Fitness);
+		return true;
+	}
+
+	void startRecording(const std::string& filename, uint32_t sample_period)
+	{
+		recorder = std::make_unique<TelemetryRecorder>(filename, thread_count, sample_period);
+	}
+
+	// Rewrites filename every period seconds with the run's live metrics
+	void startLiveStats(const std::string& filename, float period)
+	{
+		live_stats = std::make_unique<LiveStats>(filename, thread_count + 1, period);
+		live_stats->genomes_bytes = getBytesPerGenome() * population_size;
+	}
+
+	// Live stats lane of the main thread, for the results of remote workers
+	uint32_t getRemoteLane() const
+	{
+		return thread_count;
+	}
+
+	void stopRecording()
+	{
+		recorder.reset();
+	}
+
+	void recordStep(const Rocket& r, const Objective& objective, uint32_t i, uint32_t scenario_id, uint32_t step, uint32_t thread_id)
+	{
+		float values[TelemetryRecorder::ChannelsCount];
+		values[TelemetryRecorder::PositionX] = r.position.x;
+		values[TelemetryRecorder::PositionY] = r.position.y;
+		values[TelemetryRecorder::Angle] = r.getAngle();
+		values[TelemetryRecorder::ThrusterPower] = r.thruster.power;
+		values[TelemetryRecorder::ThrusterAngle] = r.thruster.angle;
+		values[TelemetryRecorder::TargetId] = float(objective.target_id);
+		values[TelemetryRecorder::TimeIn] = objective.time_in;
+		recorder->record(thread_id, selector.current_iteration, step, i, as<uint16_t>(scenario_id), values);
+	}
+
+	void aggregateFitness()
+	{
+		if (scenarios_count == 1) {
+			return;
+		}
+
+		auto& rockets = selector.getCurrentPopulation();
+		for (uint32_t i(0); i < population_size; ++i) {
+			rockets[i].fitness = getFitness(i);
+		}
 	}
 
 	void checkBestFitness(float fitness)
@@ -168,26 +489,129 @@ struct Stadium
 
 	void update(float dt, bool update_smoke)
 	{
+		Profiler::Timer timer;
 		const uint64_t population_size = selector.getCurrentPopulation().size();
 		auto group_update = swarm.execute([&](uint32_t thread_id, uint32_t max_thread) {
+			EvaluationBatch& batch = batches[thread_id];
+			Profiler::Timer worker_timer(thread_id + 1);
+			const bool timed = worker_timer.started;
+			const Profiler::Clock::time_point start = worker_timer.last;
 			const uint64_t thread_width = population_size / max_thread;
-			for (uint64_t i(thread_id * thread_width); i < (thread_id + 1) * thread_width; ++i) {
-				updateUnit(i, dt, update_smoke);
+			// The last thread also takes the remainder
+			const uint64_t end = (thread_id + 1 == max_thread) ? population_size : (thread_id + 1) * thread_width;
+			for (uint64_t i(thread_id * thread_width); i < end; ++i) {
+				updateUnit(i, dt, current_iteration.step, update_smoke, batch, worker_timer);
+			}
+			if (update_smoke) {
+				smoke.update(thread_id, dt);
+				worker_timer.lap(Profiler::Smoke);
 			}
+			// Not measured if the profiler was switched during the update
+			batch.busy_time = timed && worker_timer.started ? std::chrono::duration_cast<std::chrono::nanoseconds>(worker_timer.last - start).count() : 0;
 		});
 		group_update.waitExecutionDone();
+		addDispatchTime(timer.lap(Profiler::Update));
 		current_iteration.time += dt;
+		++current_iteration.step;
+	}
+
+	// Genomes advanced together by a worker in blocked mode, sized to stay in the L2 cache
+	uint64_t getTileSize() const
+	{
+		const uint64_t tile_bytes = 256 * 1024;
+		return std::max(uint64_t(1), tile_bytes / getBytesPerGenome());
+	}
+
+	// Number of update calls left before max_time
+	uint32_t getRemainingSteps(float dt, float max_time) const
+	{
+		uint32_t result = 0;
+		for (float time(current_iteration.time); time < max_time; time += dt) {
+			++result;
+		}
+		return result;
+	}
+
+	// Same result as steps_count calls to update without smoke, but each worker runs all the steps
+	// of a tile of genomes before moving to the next one so that their data is only loaded once.
+	// Genomes don't interact, the population is only synchronized at the end of the block
+	void updateBlocked(float dt, uint32_t steps_count, uint64_t tile_size = 0)
+	{
+		Profiler::Timer timer;
+		const uint64_t population_size = selector.getCurrentPopulation().size();
+		const uint64_t tile = tile_size ? tile_size : getTileSize();
+		const uint32_t first_step = current_iteration.step;
+		auto group_update = swarm.execute([&](uint32_t thread_id, uint32_t max_thread) {
+			EvaluationBatch& batch = batches[thread_id];
+			Profiler::Timer worker_timer(thread_id + 1);
+			const bool timed = worker_timer.started;
+			const Profiler::Clock::time_point start = worker_timer.last;
+			const uint64_t thread_width = population_size / max_thread;
+			const uint64_t end = (thread_id + 1 == max_thread) ? population_size : (thread_id + 1) * thread_width;
+			batch.active_steps = 0;
+			for (uint64_t tile_begin(thread_id * thread_width); tile_begin < end; tile_begin += tile) {
+				const uint64_t tile_end = std::min(end, tile_begin + tile);
+				for (uint32_t step(0); step < steps_count; ++step) {
+					bool tile_alive = false;
+					for (uint64_t i(tile_begin); i < tile_end; ++i) {
+						tile_alive |= updateUnit(i, dt, first_step + step, false, batch, worker_timer);
+					}
+					// The remaining steps would not change anything
+					if (!tile_alive) {
+						break;
+					}
+					batch.active_steps = std::max(batch.active_steps, step + 1);
+				}
+			}
+			// Not measured if the profiler was switched during the update
+			batch.busy_time = timed && worker_timer.started ? std::chrono::duration_cast<std::chrono::nanoseconds>(worker_timer.last - start).count() : 0;
+		});
+		group_update.waitExecutionDone();
+		addDispatchTime(timer.lap(Profiler::Update));
+		// Like update, time stops once everyone is dead
+		uint32_t active_steps = 0;
+		for (const EvaluationBatch& batch : batches) {
+			active_steps = std::max(active_steps, batch.active_steps);
+		}
+		for (uint32_t step(0); step < active_steps; ++step) {
+			current_iteration.time += dt;
+		}
+		current_iteration.step += active_steps;
+	}
+
+	// What is not spent by the slowest worker is spent dispatching and waiting
+	void addDispatchTime(int64_t update_time)
+	{
+		if (update_time) {
+			int64_t max_busy_time = 0;
+			for (const EvaluationBatch& batch : batches) {
+				max_busy_time = std::max(max_busy_time, batch.busy_time);
+			}
+			Profiler::getInstance().add(Profiler::Dispatch, 0, std::max(int64_t(0), update_time - max_busy_time));
+		}
 	}
 
 	void initializeIteration()
 	{
-		initializeTargets();
-		initializeUnits();
+		if (selector.current_iteration % scenarios_renewal == 0) {
+			initializeScenarios();
+			// Results on previous scenarios won't be asked again
+			fitness_cache.clear();
+		}
 		current_iteration.reset();
+		smoke.clear();
+		initializeUnits();
 	}
 
 	void nextIteration()
 	{
-		selector.nextGeneration();
+		storeFitness();
+		aggregateFitness();
+		if (optimizer) {
+			selector.nextGeneration(*optimizer);
+		}
+		else {
+			selector.nextGeneration();
+		}
 	}
 };
@@ -0,0 +1,169 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "stadium.hpp"
+
+
+/*
+	Evolution without generations: each evaluation slot of the stadium runs its own episode and,
+	as soon as it is over, reports its genome to a pool and starts a child bred from the pool.
+	Parents are picked by tournament and a reported genome replaces the worst of a tournament
+	if it does better, so workers never wait for each other whatever the episodes' lengths.
+	Scenarios are drawn once at start so that the pool's fitness values stay comparable.
+*/
+struct SteadyStateEvolution
+{
+	struct Member
+	{
+		DNA dna;
+		float fitness;
+	};
+
+	Stadium& stadium;
+	uint32_t pool_size;
+	uint32_t tournament_size;
+	std::vector<Member> pool;
+	Member best;
+	// Steps done by the episode of each slot
+	std::vector<uint32_t> slot_steps;
+	std::atomic<uint64_t> evaluations_count;
+	uint64_t replacements_count;
+	// Steps of the last run per slot, comparable to the steps of a generation
+	uint32_t run_steps;
+	std::mutex pool_mutex;
+
+	SteadyStateEvolution(Stadium& stadium_, uint32_t tournament_size_ = 3)
+		: stadium(stadium_)
+		, pool_size(stadium_.population_size)
+		, tournament_size(tournament_size_)
+		, best{ DNA(0), 0.0f }
+		, slot_steps(stadium_.population_size, 0)
+		, evaluations_count(0)
+		, replacements_count(0)
+		, run_steps(0)
+	{
+		pool.reserve(pool_size);
+		// The initial population is the first genomes of the slots
+		stadium.initializeIteration();
+	}
+
+	// Returns once evaluations_target more episodes are over, the others go on at the next call
+	void run(float dt, float max_time, uint64_t evaluations_target)
+	{
+		Profiler::Timer timer;
+		uint32_t max_steps = 0;
+		for (float time(0.0f); time < max_time; time += dt) {
+			++max_steps;
+		}
+
+		const uint64_t target = evaluations_count + evaluations_target;
+		const uint64_t slots_count = stadium.population_size;
+		std::atomic<uint64_t> steps_count(0);
+		auto group = stadium.swarm.execute([&](uint32_t thread_id, uint32_t max_thread) {
+			Stadium::EvaluationBatch& batch = stadium.batches[thread_id];
+			Profiler::Timer worker_timer(thread_id + 1);
+			const uint64_t thread_width = slots_count / max_thread;
+			const uint64_t end = (thread_id + 1 == max_thread) ? slots_count : (thread_id + 1) * thread_width;
+			uint64_t thread_steps = 0;
+			while (evaluations_count < target) {
+				for (uint64_t i(thread_id * thread_width); i < end; ++i) {
+					if (!stadium.updateUnit(i, dt, slot_steps[i], false, batch, worker_timer) || ++slot_steps[i] >= max_steps) {
+						finishSlot(i, thread_id);
+					}
+				}
+				++thread_steps;
+			}
+			steps_count += thread_steps * (end - thread_id * thread_width);
+		});
+		group.waitExecutionDone();
+		run_steps = static_cast<uint32_t>(steps_count / slots_count);
+		timer.lap(Profiler::Update);
+	}
+
+	// Reports the slot's genome and replaces it by a child
+	void finishSlot(uint64_t i, uint32_t thread_id)
+	{
+		Rocket& rocket = stadium.selector.getCurrentPopulation()[i];
+		const float fitness = stadium.getFitness(i);
+		{
+			// Breeding uses the shared random generators, it is done under the lock too
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			insert(rocket.dna, fitness);
+			breed(rocket);
+		}
+		++evaluations_count;
+
+		uint32_t started_count = 0;
+		for (uint32_t k(0); k < stadium.scenarios_count; ++k) {
+			Rocket& r = stadium.getBody(i, k);
+			started_count += !r.alive;
+			r.index = static_cast<uint32_t>(i);
+			stadium.initializeBody(r, stadium.getObjective(i, k), stadium.scenarios[k]);
+		}
+		slot_steps[i] = 0;
+		if (stadium.live_stats) {
+			stadium.live_stats->addSteps(thread_id, 0, started_count);
+		}
+	}
+
+	void insert(const DNA& dna, float fitness)
+	{
+		if (fitness > best.fitness || !best.dna.getBytesCount()) {
+			best = { dna, fitness };
+		}
+		if (pool.size() < pool_size) {
+			pool.push_back({ dna, fitness });
+			return;
+		}
+		const uint32_t worst = pickTournament(false);
+		if (fitness > pool[worst].fitness) {
+			pool[worst] = { dna, fitness };
+			++replacements_count;
+		}
+	}
+
+	void breed(Rocket& rocket)
+	{
+		// Until there is enough to choose from, children are new random genomes
+		if (pool.size() < std::max(2u, tournament_size)) {
+			rocket.dna.initialize<float>(1.0f);
+			rocket.reloadDNA();
+			return;
+		}
+		const Member& parent_1 = pool[pickTournament(true)];
+		const Member& parent_2 = pool[pickTournament(true)];
+		const float mutation_proba = 1.0f / sqrt(parent_1.fitness + parent_2.fitness);
+		if (parent_1.dna == parent_2.dna) {
+			DNAUtils::evolve<float>(parent_1.dna, mutation_proba, mutation_proba, rocket.dna);
+		}
+		else {
+			DNAUtils::makeChild<float>(parent_1.dna, parent_2.dna, mutation_proba, rocket.dna);
+		}
+		rocket.reloadDNA();
+	}
+
+	// Best or worst of tournament_size random members
+	uint32_t pickTournament(bool best_one)
+	{
+		const uint32_t last = static_cast<uint32_t>(pool.size() - 1);
+		uint32_t result = getIntUnder(last, NumberGenerator<>::getInstance().gen);
+		for (uint32_t i(1); i < tournament_size; ++i) {
+			const uint32_t candidate = getIntUnder(last, NumberGenerator<>::getInstance().gen);
+			if ((pool[candidate].fitness > pool[result].fitness) == best_one) {
+				result = candidate;
+			}
+		}
+		return result;
+	}
+
+	float getAverageFitness()
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		float sum = 0.0f;
+		for (const Member& member : pool) {
+			sum += member.fitness;
+		}
+		return pool.empty() ? 0.0f : sum / float(pool.size());
+	}
+};
@@ -0,0 +1,251 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include "utils.hpp"
+
+
+/*
+	Opt-in recorder of rockets trajectories. Each worker thread owns a preallocated ring
+	it writes to without locking, a background thread drains the rings to disk.
+
+	File layout, all values little endian:
+	header : "ARTL" | u32 version | u32 channels_count | per channel: char[16] name, f32 min, f32 max
+	block  : u32 n | u32 generation[n] | u32 step[n] | u32 rocket[n] | u16 scenario[n] | u16 channel_0[n] | ...
+	A channel value is decoded as min + q * (max - min) / 65535
+*/
+struct TelemetryRecorder
+{
+	enum Channel
+	{
+		PositionX,
+		PositionY,
+		Angle,
+		ThrusterPower,
+		ThrusterAngle,
+		TargetId,
+		TimeIn,
+		ChannelsCount
+	};
+
+	struct ChannelInfo
+	{
+		const char* name;
+		float min_value;
+		float max_value;
+	};
+
+	struct Sample
+	{
+		uint32_t generation;
+		uint32_t step;
+		uint32_t rocket;
+		uint16_t scenario;
+		uint16_t channels[ChannelsCount];
+	};
+
+	// Single producer (a worker) single consumer (the writer) ring
+	struct Lane
+	{
+		std::vector<Sample> samples;
+		std::atomic<uint64_t> head;
+		std::atomic<uint64_t> tail;
+		uint64_t dropped;
+
+		Lane()
+			: head(0)
+			, tail(0)
+			, dropped(0)
+		{}
+	};
+
+	static const ChannelInfo* getChannels()
+	{
+		static const ChannelInfo channels[ChannelsCount] = {
+			{ "position_x"    , -1000.0f   , 3000.0f  },
+			{ "position_y"    , -1000.0f   , 3000.0f  },
+			{ "angle"         , -4.0f * PI , 4.0f * PI},
+			{ "thruster_power", 0.0f       , 1.0f     },
+			{ "thruster_angle", -HalfPI    , HalfPI   },
+			{ "target_id"     , 0.0f       , 65535.0f },
+			{ "time_in"       , 0.0f       , 5.0f     },
+		};
+		return channels;
+	}
+
+	// lane_capacity is rounded up to a power of two so that indexes can be masked
+	TelemetryRecorder(const std::string& filename, uint32_t lanes_count, uint32_t sample_period_, uint32_t lane_capacity = 1u << 16)
+		: sample_period(sample_period_)
+		, capacity_mask(getNextPowerOfTwo(lane_capacity) - 1)
+		, lanes(lanes_count)
+		, outfile(filename, std::ios::out | std::ios::binary | std::ios::trunc)
+		, running(true)
+	{
+		for (Lane& lane : lanes) {
+			lane.samples.resize(capacity_mask + 1);
+		}
+		writeHeader();
+		writer = std::thread(&TelemetryRecorder::run, this);
+	}
+
+	~TelemetryRecorder()
+	{
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			running = false;
+		}
+		condition.notify_one();
+		writer.join();
+	}
+
+	void select(uint32_t rocket, bool recorded = true)
+	{
+		if (rocket >= selected.size()) {
+			selected.resize(rocket + 1, 0);
+		}
+		selected[rocket] = recorded;
+	}
+
+	bool isRecorded(uint32_t rocket, uint32_t step) const
+	{
+		return (sample_period && step % sample_period == 0) || (rocket < selected.size() && selected[rocket]);
+	}
+
+	static uint16_t quantize(float value, const ChannelInfo& channel)
+	{
+		const float ratio = (value - channel.min_value) / (channel.max_value - channel.min_value);
+		return static_cast<uint16_t>(clamp(0.0f, 1.0f, ratio) * 65535.0f + 0.5f);
+	}
+
+	// Never blocks, samples are dropped if the writer is late
+	void record(uint32_t lane_id, uint32_t generation, uint32_t step, uint32_t rocket, uint16_t scenario, const float* values)
+	{
+		Lane& lane = lanes[lane_id];
+		const uint64_t head = lane.head.load(std::memory_order_relaxed);
+		if (head - lane.tail.load(std::memory_order_acquire) > capacity_mask) {
+			++lane.dropped;
+			return;
+		}
+
+		Sample& sample = lane.samples[head & capacity_mask];
+		sample.generation = generation;
+		sample.step = step;
+		sample.rocket = rocket;
+		sample.scenario = scenario;
+		const ChannelInfo* channels = getChannels();
+		for (uint32_t i(0); i < ChannelsCount; ++i) {
+			sample.channels[i] = quantize(values[i], channels[i]);
+		}
+		lane.head.store(head + 1, std::memory_order_release);
+	}
+
+	uint64_t getDroppedCount() const
+	{
+		uint64_t result = 0;
+		for (const Lane& lane : lanes) {
+			result += lane.dropped;
+		}
+		return result;
+	}
+
+	uint32_t sample_period;
+	std::vector<uint8_t> selected;
+	const uint64_t capacity_mask;
+	std::vector<Lane> lanes;
+	std::ofstream outfile;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool running;
+
+	std::vector<uint32_t> column_u32;
+	std::vector<uint16_t> column_u16;
+
+	template<typename T>
+	void write(const T& value)
+	{
+		outfile.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	void writeColumn(const std::vector<T>& column)
+	{
+		outfile.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+	}
+
+	void writeHeader()
+	{
+		outfile.write("ARTL", 4);
+		write(uint32_t(1));
+		write(uint32_t(ChannelsCount));
+		const ChannelInfo* channels = getChannels();
+		for (uint32_t i(0); i < ChannelsCount; ++i) {
+			char name[16] = {};
+			std::strncpy(name, channels[i].name, sizeof(name) - 1);
+			outfile.write(name, sizeof(name));
+			write(channels[i].min_value);
+			write(channels[i].max_value);
+		}
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> ul(mutex);
+		while (running) {
+			condition.wait_for(ul, std::chrono::milliseconds(100));
+			ul.unlock();
+			flush();
+			ul.lock();
+		}
+		flush();
+	}
+
+	void flush()
+	{
+		for (Lane& lane : lanes) {
+			const uint64_t tail = lane.tail.load(std::memory_order_relaxed);
+			const uint64_t head = lane.head.load(std::memory_order_acquire);
+			const uint32_t count = static_cast<uint32_t>(head - tail);
+			if (!count) {
+				continue;
+			}
+
+			write(count);
+			writeU32Column(lane, tail, count, [](const Sample& s) { return s.generation; });
+			writeU32Column(lane, tail, count, [](const Sample& s) { return s.step; });
+			writeU32Column(lane, tail, count, [](const Sample& s) { return s.rocket; });
+			writeU16Column(lane, tail, count, [](const Sample& s) { return s.scenario; });
+			for (uint32_t c(0); c < ChannelsCount; ++c) {
+				writeU16Column(lane, tail, count, [c](const Sample& s) { return s.channels[c]; });
+			}
+			lane.tail.store(head, std::memory_order_release);
+		}
+		outfile.flush();
+	}
+
+	template<typename Getter>
+	void writeU32Column(const Lane& lane, uint64_t tail, uint32_t count, Getter getter)
+	{
+		column_u32.resize(count);
+		for (uint32_t i(0); i < count; ++i) {
+			column_u32[i] = getter(lane.samples[(tail + i) & capacity_mask]);
+		}
+		writeColumn(column_u32);
+	}
+
+	template<typename Getter>
+	void writeU16Column(const Lane& lane, uint64_t tail, uint32_t count, Getter getter)
+	{
+		column_u16.resize(count);
+		for (uint32_t i(0); i < count; ++i) {
+			column_u16[i] = getter(lane.samples[(tail + i) & capacity_mask]);
+		}
+		writeColumn(column_u16);
+	}
+};
@@ -14,9 +14,14 @@ struct Unit
 
 	void loadDNA(const DNA& new_dna)
 	{
-		fitness = 0.0f;
 		dna = new_dna;
+		reloadDNA();
+	}
 
+	// To call once dna has been written in place
+	void reloadDNA()
+	{
+		fitness = 0.0f;
 		onUpdateDNA();
 	}
 
@@ -84,6 +84,14 @@ std::string toString(const T& v, const uint8_t decimals = 2)
 	return sx.str();
 }
 
+// Returns base + extension, or base_N + extension if the file already exists
+std::string getAvailableFilename(const std::string& base_filename, const std::string& extension);
+
+
+// Smallest power of two not below value, at least 1
+uint64_t getNextPowerOfTwo(uint64_t value);
+
+
 sf::RectangleShape getLine(const sf::Vector2f& point_1, const sf::Vector2f& point_2, const float width, const sf::Color& color);
 
 
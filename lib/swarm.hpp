@@ -9,6 +9,11 @@
 #include <chrono>
 #include <condition_variable>
 #include <memory>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace swrm
 {
@@ -21,9 +26,12 @@ using WorkerFunction = std::function<void(uint32_t, uint32_t)>;
 class Worker
 {
 public:
-	Worker(Swarm* swarm);
+	Worker(Swarm* swarm, uint32_t index);
 
 	void createThread();
+	// Returns false if the OS refused or does not support it
+	bool pin(int32_t cpu);
+	uint32_t getIndex() const;
 
 	void lockReady();
 	void lockDone();
@@ -36,6 +44,8 @@ public:
 
 private:
 	bool m_running;
+	// Creation order, workers always get the same ids in groups of the same size
+	uint32_t m_index;
 	uint32_t m_id;
 	uint32_t m_group_size;
 
@@ -157,7 +167,9 @@ private:
 
 	void retrieveWorkers(std::list<Worker*>& available_workers)
 	{
-		for (uint32_t i(m_group_size); i--;) {
+		// So that a job id keeps running on the same core when workers are pinned
+		available_workers.sort([](const Worker* a, const Worker* b) { return a->getIndex() < b->getIndex(); });
+		for (uint32_t i(0); i < m_group_size; ++i) {
 			Worker* worker = available_workers.front();
 			available_workers.pop_front();
 			worker->setJob(i, this);
@@ -193,12 +205,17 @@ private:
 class Swarm
 {
 public:
-	Swarm(uint32_t thread_count)
+	// Worker i is pinned to cpus[i % cpus.size()] if cpus is not empty
+	Swarm(uint32_t thread_count, const std::vector<int32_t>& cpus = {})
 		: m_thread_count(thread_count)
+		, m_pinned_count(0U)
 		, m_ready_count(0U)
 	{
-		for (uint32_t i(thread_count); i--;) {
-			createWorker();
+		for (uint32_t i(0); i < thread_count; ++i) {
+			createWorker(i);
+			if (!cpus.empty() && m_workers.back()->pin(cpus[i % cpus.size()])) {
+				++m_pinned_count;
+			}
 		}
 
 		while (m_ready_count < m_thread_count) {}
@@ -218,25 +235,40 @@ public:
 			group_size = m_thread_count;
 		}
 
-		if (group_size > m_available_workers.size()) {
+		if (group_size > m_thread_count) {
 			return WorkGroup();
 		}
 
+		// Workers of the previous group may not be available again yet
+		std::unique_lock<std::mutex> ul(m_mutex);
+		m_available_condition.wait(ul, [&] { return m_available_workers.size() >= group_size; });
 		return WorkGroup(std::make_unique<ExecutionGroup>(job, group_size, m_available_workers));
 	}
 
+	uint32_t getThreadCount() const
+	{
+		return m_thread_count;
+	}
+
+	uint32_t getPinnedCount() const
+	{
+		return m_pinned_count;
+	}
+
 
 private:
 	const uint32_t m_thread_count;
+	uint32_t m_pinned_count;
 
 	std::atomic<uint32_t> m_ready_count;
 	std::list<Worker*>  m_workers;
 	std::list<Worker*>  m_available_workers;
 	std::mutex m_mutex;
+	std::condition_variable m_available_condition;
 
-	void createWorker()
+	void createWorker(uint32_t index)
 	{
-		Worker* new_worker = new Worker(this);
+		Worker* new_worker = new Worker(this, index);
 		new_worker->createThread();
 		m_workers.push_back(new_worker);
 	}
@@ -250,20 +282,24 @@ private:
 
 	void notifyWorkerReady(Worker* worker)
 	{
-		std::lock_guard<std::mutex> lg(m_mutex);
-		++m_ready_count;
-		m_available_workers.push_back(worker);
+		{
+			std::lock_guard<std::mutex> lg(m_mutex);
+			++m_ready_count;
+			m_available_workers.push_back(worker);
+		}
+		m_available_condition.notify_one();
 	}
 
 	friend Worker;
 };
 
-Worker::Worker(Swarm* swarm)
-	: m_swarm(swarm)
-	, m_group(nullptr)
+Worker::Worker(Swarm* swarm, uint32_t index)
+	: m_running(true)
+	, m_index(index)
 	, m_id(0)
 	, m_group_size(0)
-	, m_running(true)
+	, m_swarm(swarm)
+	, m_group(nullptr)
 	, m_ready_mutex()
 	, m_done_mutex()
 {
@@ -275,6 +311,23 @@ void Worker::createThread()
 	m_thread = std::thread(&Worker::run, this);
 }
 
+bool Worker::pin(int32_t cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(m_thread.native_handle(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+uint32_t Worker::getIndex() const
+{
+	return m_index;
+}
+
 void Worker::run()
 {
 	while (true) {
@@ -3,6 +3,8 @@
 #include <list>
 #include <event_manager.hpp>
 #include <iostream>
+#include <thread>
+#include <atomic>
 
 #include "dna.hpp"
 #include "selector.hpp"
@@ -12,6 +14,10 @@
 #include "stadium.hpp"
 #include "rocket_renderer.hpp"
 #include "neural_renderer.hpp"
+#include "replay.hpp"
+#include "profiler.hpp"
+#include "frame_snapshot.hpp"
+#include "double_buffer.hpp"
 
 
 int main()
@@ -24,15 +30,16 @@ int main()
 	settings.antialiasingLevel = 4;
 	sf::RenderWindow window(sf::VideoMode(win_width, win_height), "SpaceY", sf::Style::Default, settings);
 	window.setVerticalSyncEnabled(false);
-	window.setFramerateLimit(144);
 
 	bool slow_motion = false;
 	const float base_dt = 0.007f;
 	float dt = base_dt;
 
+	// The window is only closed once the render thread is done with it
+	bool exit_requested = false;
 	sfev::EventManager event_manager(window);
-	event_manager.addEventCallback(sf::Event::Closed, [&](sfev::CstEv ev) { window.close(); });
-	event_manager.addKeyPressedCallback(sf::Keyboard::Escape, [&](sfev::CstEv ev) { window.close(); });
+	event_manager.addEventCallback(sf::Event::Closed, [&](sfev::CstEv ev) { exit_requested = true; });
+	event_manager.addKeyPressedCallback(sf::Keyboard::Escape, [&](sfev::CstEv ev) { exit_requested = true; });
 
 	// The drones colors
 	std::vector<sf::Color> colors({ sf::Color(36, 123, 160),
@@ -50,17 +57,34 @@ int main()
 
 	bool show_just_one = true;
 	bool full_speed = false;
+	bool turbo = false;
 	bool manual_control = false;
 	bool draw_neural = true;
 	bool draw_rockets = true;
 	bool draw_fitness = true;
+	bool heatmap = false;
+	DensityGrid::Mode heatmap_mode = DensityGrid::Density;
 
-	event_manager.addKeyPressedCallback(sf::Keyboard::E, [&](sfev::CstEv ev) { full_speed = !full_speed; window.setFramerateLimit(!full_speed * 144); });
+	event_manager.addKeyPressedCallback(sf::Keyboard::E, [&](sfev::CstEv ev) { full_speed = !full_speed; });
+	event_manager.addKeyPressedCallback(sf::Keyboard::U, [&](sfev::CstEv ev) { turbo = !turbo; });
 	event_manager.addKeyPressedCallback(sf::Keyboard::M, [&](sfev::CstEv ev) { manual_control = !manual_control; });
 	event_manager.addKeyPressedCallback(sf::Keyboard::S, [&](sfev::CstEv ev) { show_just_one = !show_just_one; });
 	event_manager.addKeyPressedCallback(sf::Keyboard::N, [&](sfev::CstEv ev) { draw_neural = !draw_neural; });
 	event_manager.addKeyPressedCallback(sf::Keyboard::D, [&](sfev::CstEv ev) { draw_rockets = !draw_rockets; });
 	event_manager.addKeyPressedCallback(sf::Keyboard::F, [&](sfev::CstEv ev) { draw_fitness = !draw_fitness; });
+	// Cycles through the heatmap modes then back to the swarm view
+	event_manager.addKeyPressedCallback(sf::Keyboard::H, [&](sfev::CstEv ev) {
+		if (!heatmap) {
+			heatmap = true;
+			heatmap_mode = DensityGrid::Density;
+		}
+		else if (heatmap_mode + 1 < DensityGrid::ModesCount) {
+			heatmap_mode = static_cast<DensityGrid::Mode>(heatmap_mode + 1);
+		}
+		else {
+			heatmap = false;
+		}
+	});
 
 	const float GUI_MARGIN = 10.0f;
 	Graphic fitness_graph(1000, sf::Vector2f(700, 120), sf::Vector2f(GUI_MARGIN, win_height - 120 - GUI_MARGIN));
@@ -78,88 +102,362 @@ int main()
 	best_score_text = generation_text;
 	best_score_text.setCharacterSize(32);
 	best_score_text.setPosition(4.0f * GUI_MARGIN, 64);
+
+	// Per phase timings of the last generation
+	Profiler& profiler = Profiler::getInstance();
+	bool draw_profiler = false;
+	sf::Text profiler_text = generation_text;
+	profiler_text.setCharacterSize(14);
+	profiler_text.setPosition(win_width - 260.0f, GUI_MARGIN);
+	std::string profiler_string = "Profiling...";
+	event_manager.addKeyPressedCallback(sf::Keyboard::P, [&](sfev::CstEv ev) {
+		draw_profiler = !draw_profiler;
+		profiler.enabled = draw_profiler;
+		if (draw_profiler && !profiler.csv.is_open()) {
+			profiler.setCsvOutput(getAvailableFilename("../profile", ".csv"));
+		}
+	});
 	
 	const uint32_t pop_size = 2000;
-	Stadium stadium(pop_size, sf::Vector2f(win_width, win_height));
+	const uint32_t scenarios_count = 4;
+	Stadium stadium(pop_size, sf::Vector2f(win_width, win_height), scenarios_count);
+	stadium.scenarios_renewal = 5;
+	stadium.use_fitness_cache = true;
+	stadium.rotation_vectors = true;
+
+	// Telemetry of all rockets every 10 steps
+	event_manager.addKeyPressedCallback(sf::Keyboard::T, [&](sfev::CstEv ev) {
+		if (stadium.recorder) {
+			stadium.stopRecording();
+		}
+		else {
+			const std::string filename = getAvailableFilename("../telemetry", ".bin");
+			stadium.startRecording(filename, 10);
+			std::cout << "Recording telemetry in " << filename << std::endl;
+		}
+	});
 
 	RocketRenderer rocket_renderer;
 	NeuralRenderer neural_renderer;
 	const sf::Vector2f size = neural_renderer.getSize(4, 9);
+
+	// Replay of the previous generation's champion
+	Replay replay;
+	bool show_replay = false;
+	bool has_champion = false;
+	uint32_t champion_seed = 0;
+	float replay_time = 0.0f;
+	event_manager.addKeyPressedCallback(sf::Keyboard::R, [&](sfev::CstEv ev) {
+		show_replay = has_champion && !show_replay;
+		if (show_replay) {
+			replay.load(stadium, stadium.selector.getBest().dna, champion_seed, dt);
+			replay_time = 0.0f;
+		}
+	});
+	event_manager.addKeyPressedCallback(sf::Keyboard::Left, [&](sfev::CstEv ev) { replay_time = std::max(0.0f, replay_time - 1.0f); });
+	event_manager.addKeyPressedCallback(sf::Keyboard::Right, [&](sfev::CstEv ev) { replay_time = std::min(replay.getDuration(), replay_time + 1.0f); });
 	neural_renderer.position = sf::Vector2f(50.0f, win_height) - sf::Vector2f(0.0f, GUI_MARGIN + size.y);
 
 	sf::RenderStates states;
 	states.transform.scale(1.2f, 1.2f);
 	states.transform.translate(-160.0f, -90.0f);
-	float time = 0.0f;
+	// Simulation runs with a fixed dt, rendering and events have their own wall clock rates
+	const float render_period = 1.0f / 60.0f;
+	const float events_period = 1.0f / 100.0f;
+	const float max_accumulated_time = 0.25f;
+	sf::Clock render_clock;
+	sf::Clock events_clock;
+	sf::Clock simulation_clock;
+	float accumulated_time = 0.0f;
+
+	auto is_running = [&]() {
+		return stadium.getAliveCount() && !exit_requested && stadium.current_iteration.time < 90.0f;
+	};
 
-	while (window.isOpen()) {
+	// Nothing is drawn during a generation in turbo mode, the population is advanced by blocks of steps
+	const uint32_t turbo_block_steps = 32;
+	auto step = [&]() {
+		if (turbo) {
+			stadium.updateBlocked(dt, std::min(turbo_block_steps, stadium.getRemainingSteps(dt, 90.0f)));
+		}
+		else {
+			stadium.update(dt, !full_speed);
+		}
+	};
+
+	auto poll_events = [&]() {
+		Profiler::Timer timer;
 		event_manager.processEvents();
+		if (manual_control) {
+			const sf::Vector2i mouse_position = sf::Mouse::getPosition(window);
+			mouse_target.x = static_cast<float>(mouse_position.x);
+			mouse_target.y = static_cast<float>(mouse_position.y);
+		}
+		events_clock.restart();
+		timer.lap(Profiler::Events);
+	};
 
-		// Initialize rockets
-		std::vector<Rocket>& population = stadium.selector.getCurrentPopulation();
-		stadium.initializeIteration();
+	// The simulation copies what has to be drawn, the render thread draws the latest copy
+	TripleObject<FrameSnapshot> snapshots;
+	DensityGrid density_grid(160, 90, stadium.area_size);
+	HeatmapRenderer heatmap_renderer;
+	// Best fitness of each finished generation
+	std::vector<float> generation_bests;
 
-		time = 0.0f;
+	auto publish = [&]() {
+		Profiler::Timer timer;
+		const float frame_time = render_clock.restart().asSeconds();
+		FrameSnapshot& frame = snapshots.getBack();
+		frame.generation = stadium.selector.current_iteration;
+		frame.best_fitness = stadium.current_iteration.best_fitness;
+		// The render thread may have skipped frames, it gets the bests it could have missed
+		const uint64_t kept_count = std::min(generation_bests.size(), uint64_t(FrameSnapshot::kept_bests_count));
+		frame.generation_bests.assign(generation_bests.end() - kept_count, generation_bests.end());
+		frame.draw_fitness = draw_fitness;
+		frame.draw_profiler = draw_profiler;
+		frame.profiler_text = profiler_string;
+		frame.draw_details = !full_speed;
+		frame.swarm_view = false;
+		frame.heatmap_view = false;
+		frame.has_focused_rocket = false;
+		frame.smoke.clear();
+		stadium.smoke_emitter = Stadium::NoSmokeEmitter;
 
-		while (stadium.getAliveCount() && window.isOpen() && stadium.current_iteration.time < 90.0f) {
-			event_manager.processEvents();
+		const std::vector<Rocket>& population = stadium.selector.getCurrentPopulation();
+		uint32_t current_drone_i = 0;
+		if (show_replay) {
+			replay_time += frame_time;
+			if (replay_time > replay.getDuration()) {
+				replay_time = 0.0f;
+			}
+			replay.seek(replay_time);
+			frame.focused_rocket = replay.rocket;
+			frame.has_focused_rocket = true;
+		}
+		else if (draw_rockets && show_just_one) {
+			for (const Rocket& r : population) {
+				if (r.alive) {
+					frame.focused_rocket = r;
+					frame.has_focused_rocket = true;
+					current_drone_i = r.index;
+					stadium.smoke_emitter = r.index;
+					if (!full_speed) {
+						stadium.smoke.forEach(r.index, [&](const SmokeSystem::Particle& p) { frame.smoke.push_back(p); });
+					}
+					break;
+				}
+			}
+		}
+		else if (draw_rockets && heatmap) {
+			frame.heatmap_view = true;
+			density_grid.accumulate(population, heatmap_mode, frame.heatmap, &stadium.swarm);
+			frame.heatmap_width = density_grid.width;
+			frame.heatmap_height = density_grid.height;
+			for (const Rocket& r : population) {
+				if (r.alive) {
+					frame.focused_rocket = r;
+					frame.has_focused_rocket = true;
+					break;
+				}
+			}
+		}
+		else if (draw_rockets) {
+			frame.swarm_view = true;
+			frame.rockets.resize(population.size());
+			for (uint64_t i(0); i < population.size(); ++i) {
+				frame.rockets[i].set(population[i]);
+			}
+			// Gauges only for the first rocket still alive
+			for (const Rocket& r : population) {
+				if (r.alive) {
+					frame.focused_rocket = r;
+					frame.has_focused_rocket = true;
+					break;
+				}
+			}
+		}
 
-			if (manual_control) {
-				const sf::Vector2i mouse_position = sf::Mouse::getPosition(window);
-				mouse_target.x = static_cast<float>(mouse_position.x);
-				mouse_target.y = static_cast<float>(mouse_position.y);
+		frame.draw_target = false;
+		frame.draw_network = false;
+		if (show_just_one || show_replay) {
+			const Objective& obj = show_replay ? replay.objective : stadium.getObjective(current_drone_i, 0);
+			const std::vector<sf::Vector2f>& targets = show_replay ? replay.scenario.targets : stadium.scenarios[0].targets;
+			frame.draw_target = true;
+			frame.target = targets[obj.target_id];
+			frame.time_in = obj.time_in;
+			frame.target_visible = obj.target_id < stadium.targets_count - 1;
+			if (!full_speed && !show_replay) {
+				frame.draw_network = true;
+				const Network& network = population[current_drone_i].network;
+				frame.network = network;
+				frame.network_parameters.assign(network.parameters, network.parameters + network.getParametersCount());
+				frame.network.bind(frame.network_parameters.data());
+				// Rockets don't keep their network's values, they are computed again for display
+				float to_target_dist;
+				frame.network_state.resize(network.getStateSize());
+				stadium.writeInputs(population[current_drone_i], obj, stadium.scenarios[0], dt, frame.network_state.data(), to_target_dist);
+				frame.network.execute(frame.network_state.data());
 			}
+		}
 
-			stadium.update(dt, !full_speed);
+		snapshots.publish();
+		timer.lap(Profiler::Publish);
+	};
 
-			fitness_graph.setLastValue(stadium.current_iteration.best_fitness);
-			generation_text.setString("Generation " + toString(stadium.selector.current_iteration));
-			best_score_text.setString("Score " + toString(stadium.current_iteration.best_fitness));
-
-			// Render
-			window.clear();
-
-			uint32_t current_drone_i = 0;
-			if (draw_rockets) {
-				for (Rocket& r : population) {
-					if (r.alive) {
-						rocket_renderer.render(r, window, states, !full_speed && show_just_one);
-						if (show_just_one) {
-							current_drone_i = r.index;
-							break;
-						}
-					}
-				}
+	// Render thread, it has its own profiler lane
+	const uint32_t render_lane = stadium.thread_count + 1;
+	profiler.setThreadCount(render_lane);
+	uint32_t graph_generation = 0;
+
+	auto draw_frame = [&](const FrameSnapshot& frame) {
+		Profiler::Timer frame_timer(render_lane);
+		// Generations finished since the last frame
+		const uint32_t first_kept = frame.generation - static_cast<uint32_t>(frame.generation_bests.size());
+		while (graph_generation < frame.generation) {
+			// Older ones would already have scrolled out of the graph
+			if (graph_generation >= first_kept) {
+				fitness_graph.setLastValue(frame.generation_bests[graph_generation - first_kept]);
+				fitness_graph.next();
+			}
+			++graph_generation;
+		}
+		fitness_graph.setLastValue(frame.best_fitness);
+		generation_text.setString("Generation " + toString(frame.generation));
+		best_score_text.setString("Score " + toString(frame.best_fitness));
+
+		window.clear();
+
+		if (frame.swarm_view) {
+			rocket_renderer.renderSwarm(frame.rockets, window, states);
+			if (frame.has_focused_rocket) {
+				rocket_renderer.renderGauges(frame.focused_rocket, window, states);
+			}
+		}
+		else if (frame.heatmap_view) {
+			heatmap_renderer.render(frame.heatmap, frame.heatmap_width, frame.heatmap_height, stadium.area_size, window, states);
+			if (frame.has_focused_rocket) {
+				rocket_renderer.render(frame.focused_rocket, window, states);
+			}
+		}
+		else if (frame.has_focused_rocket) {
+			rocket_renderer.render(frame.focused_rocket, window, states, &frame.smoke);
+		}
+		frame_timer.lap(Profiler::RenderRockets);
+
+		if (frame.draw_target) {
+			const float target_radius = 10.0f;
+			sf::CircleShape target_c(target_radius);
+			target_c.setFillColor(sf::Color(255, 128, 0));
+			target_c.setOrigin(target_radius, target_radius);
+			target_c.setPosition(frame.target);
+			if (frame.target_visible) {
+				window.draw(target_c, states);
 			}
-			
-			if (show_just_one) {
-				const float target_radius = 10.0f;
-				sf::CircleShape target_c(target_radius);
-				target_c.setFillColor(sf::Color(255, 128, 0));
-				target_c.setOrigin(target_radius, target_radius);
-				const Objective& obj = stadium.objectives[current_drone_i];
-				target_c.setPosition(stadium.targets[obj.target_id]);
-				if (obj.target_id < stadium.targets_count - 1) {
-					window.draw(target_c, states);
+
+			if (frame.draw_details) {
+				RocketRenderer::drawPie(target_radius - 3.0f, (frame.time_in / 3.0f) * 2.0f * PI, sf::Color(75, 75, 75), frame.target, window, states);
+				frame_timer.lap(Profiler::RenderTargets);
+				if (frame.draw_network) {
+					neural_renderer.render(window, frame.network, frame.network_state.data(), sf::RenderStates());
 				}
+				frame_timer.lap(Profiler::RenderNetwork);
+			}
+		}
+		frame_timer.lap(Profiler::RenderTargets);
+
+		if (frame.draw_fitness) {
+			fitness_graph.render(window);
+		}
+		if (frame.draw_profiler) {
+			profiler_text.setString(frame.profiler_text);
+			window.draw(profiler_text);
+		}
+		frame_timer.lap(Profiler::RenderFitness);
+
+		window.display();
+		frame_timer.lap(Profiler::Display);
+	};
 
-				if (!full_speed) {
-					RocketRenderer::drawPie(target_radius - 3.0f, (obj.time_in / 3.0f) * 2.0f * PI, sf::Color(75, 75, 75), stadium.targets[obj.target_id], window, states);
-					neural_renderer.render(window, stadium.selector.getCurrentPopulation()[current_drone_i].network, sf::RenderStates());
+	std::atomic<bool> render_running(true);
+	window.setActive(false);
+	std::thread render_thread([&]() {
+		window.setActive(true);
+		while (render_running) {
+			if (snapshots.acquire()) {
+				draw_frame(snapshots.getFront());
+			}
+			else {
+				sf::sleep(sf::milliseconds(1));
+			}
+		}
+		window.setActive(false);
+	});
+
+	while (!exit_requested) {
+		poll_events();
+
+		// Initialize rockets
+		stadium.initializeIteration();
+		simulation_clock.restart();
+		accumulated_time = 0.0f;
+
+		while (is_running()) {
+			if (full_speed || turbo) {
+				// Fast forward, only stop to render or poll events
+				do {
+					step();
+				} while (is_running()
+					&& (turbo || render_clock.getElapsedTime().asSeconds() < render_period)
+					&& events_clock.getElapsedTime().asSeconds() < events_period);
+				simulation_clock.restart();
+			}
+			else {
+				// Real time, consume the elapsed wall clock time by steps of dt
+				accumulated_time = std::min(max_accumulated_time, accumulated_time + simulation_clock.restart().asSeconds());
+				while (accumulated_time >= dt && is_running()) {
+					step();
+					accumulated_time -= dt;
 				}
 			}
 
-			if (draw_fitness) {
-				fitness_graph.render(window);
+			if (events_clock.getElapsedTime().asSeconds() >= events_period) {
+				poll_events();
 			}
 
-			window.display();
-			time += dt;
+			if (!turbo && render_clock.getElapsedTime().asSeconds() >= render_period) {
+				publish();
+			}
+			else if (!full_speed && !turbo) {
+				sf::sleep(sf::milliseconds(1));
+			}
+		}
+
+		// In turbo mode the only frame of the generation is its last one
+		if (turbo && !exit_requested) {
+			publish();
 		}
 		
-		fitness_graph.next();
+		generation_bests.push_back(stadium.current_iteration.best_fitness);
+		champion_seed = stadium.scenarios[0].seed;
+		has_champion = true;
+		const uint32_t steps_count = stadium.current_iteration.step;
 		stadium.nextIteration();
+
+		if (profiler.enabled) {
+			const Profiler::Row& row = profiler.endGeneration(stadium.selector.current_iteration - 1, steps_count);
+			std::stringstream sstr;
+			sstr << std::fixed << std::setprecision(2);
+			sstr << "Generation " << row.generation << " (" << row.steps << " steps)\n";
+			for (uint32_t i(0); i < Profiler::PhasesCount; ++i) {
+				sstr << Profiler::getPhaseName(i) << ": " << row.milliseconds[i] << " ms\n";
+			}
+			profiler_string = sstr.str();
+		}
 	}
 
+	render_running = false;
+	render_thread.join();
+	window.close();
+
 	return 0;
-}
\ No newline at end of file
+}
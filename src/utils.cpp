@@ -1,6 +1,7 @@
 #include "utils.hpp"
 
 #include <limits>
+#include <fstream>
 
 std::random_device rd;
 std::mt19937 gen(0);
@@ -99,6 +100,31 @@ float sigm(const float f)
 	return 1.0f / (1.0f + exp(-f));
 }
 
+std::string getAvailableFilename(const std::string& base_filename, const std::string& extension)
+{
+	std::string filename = base_filename + extension;
+	std::ifstream ifs(filename);
+	uint32_t try_count = 0;
+	while (ifs) {
+		ifs.close();
+		++try_count;
+		std::stringstream sstr;
+		sstr << base_filename << "_" << try_count << extension;
+		filename = sstr.str();
+		ifs.open(filename);
+	}
+	return filename;
+}
+
+uint64_t getNextPowerOfTwo(uint64_t value)
+{
+	uint64_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
 sf::RectangleShape getLine(const sf::Vector2f& point_1, const sf::Vector2f& point_2, const float width, const sf::Color& color)
 {
 	const sf::Vector2f vec = point_2 - point_1;